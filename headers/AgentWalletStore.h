@@ -0,0 +1,102 @@
+
+#pragma once
+
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/** wallets for thousands of simulated agents, held as dense balance tables split into shards.
+ *  Agent ids start at 1; agent id 0 is left for the interactive user's own Wallet.
+ *  Agents are dealt round-robin across shards, and each shard keeps one row of balances
+ *  per agent with one column per currency, so a fill touches two adjacent doubles */
+class AgentWalletStore
+{
+    public:
+
+        /** shardCount of 0 picks one shard per hardware thread */
+        AgentWalletStore(unsigned int shardCount = 0);
+
+        /** stop and join the settle workers */
+        ~AgentWalletStore();
+
+        /** create count new agents, each funded with these balances; returns the id of the first one */
+        uint32_t addAgents(uint32_t count, std::map<std::string, double>& initialBalances);
+
+        uint32_t getAgentCount();
+
+        double getBalance(uint32_t agentId, const std::string& currency);
+
+        /** check if the agent can cope with this ask or bid */
+        bool canFulfillOrder(const OrderBookEntry& order);
+
+        /** apply every agent fill of a timeframe; large batches are settled with one worker per shard */
+        void settle(std::vector<OrderBookEntry>& sales);
+
+        /** flatten every balance out, agent by agent, for checkpointing */
+        void exportBalances(std::vector<std::string>& currencyNames, std::vector<double>& balances);
+
+        /** replace the whole store with balances made by exportBalances() */
+        void importBalances(std::vector<std::string>& currencyNames, std::vector<double>& balances);
+
+        /** print the number of agents and their combined holdings */
+        std::string toString();
+
+    private:
+
+        struct Shard
+        {
+            uint32_t agentCount = 0;
+
+            /** agentCount rows of currencies.size() columns */
+            std::vector<double> balances;
+        };
+
+        /** a change to one balance, computed before the shards are settled in parallel */
+        struct BalanceChange
+        {
+            uint32_t row;
+            unsigned int currency;
+            double amount;
+        };
+
+        /** return the column of a currency, widening every shard if it is new */
+        unsigned int getCurrencyIndex(const std::string& currency);
+
+        /** return the columns of a product's two currencies; parsed once per product */
+        std::pair<unsigned int, unsigned int> getProductCurrencies(const std::string& product);
+
+        Shard& getShard(uint32_t agentId);
+        uint32_t getRow(uint32_t agentId);
+
+        /** apply the pending changes of one shard to its table */
+        void settleShard(size_t s);
+
+        /** loop of the worker that owns shard s: wait for a batch, settle it, report back */
+        void runSettleWorker(size_t s);
+
+        std::vector<Shard> shards;
+        uint32_t agentCount;
+
+        std::vector<std::string> currencies;
+        std::unordered_map<std::string, unsigned int> currencyIndex;
+        std::unordered_map<std::string, std::pair<unsigned int, unsigned int>> productCurrencies;
+
+        /** balance changes of the batch being settled, one list per shard */
+        std::vector<std::vector<BalanceChange>> changes;
+
+        /** one worker per shard after the first, which the calling thread settles itself;
+         *  started on the first large batch and kept for the rest of the run */
+        std::vector<std::thread> workers;
+        std::mutex settleMutex;
+        std::condition_variable settleStarted;
+        std::condition_variable settleFinished;
+        uint64_t settleGeneration;
+        size_t workersBusy;
+        bool stopping;
+};
\ No newline at end of file
@@ -0,0 +1,62 @@
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+/** appends fixed-width little-endian values to a byte buffer.
+ *  Every file written with it starts with a four-byte magic and a version number, checked
+ *  before anything else is read, so foreign or outdated files are rejected up front */
+class BinaryWriter
+{
+    public:
+
+        BinaryWriter();
+
+        void writeUInt8(uint8_t value);
+        void writeUInt32(uint32_t value);
+        void writeUInt64(uint64_t value);
+        void writeDouble(double value);
+
+        /** 7 bits per byte, small values take a single byte */
+        void writeVarint(uint64_t value);
+
+        /** strings are written as a 32-bit length followed by their bytes */
+        void writeString(const std::string& value);
+
+        /** return the bytes written so far */
+        std::string& getBuffer();
+
+    private:
+
+        std::string buffer;
+};
+
+/** reads values written by BinaryWriter back out of a byte buffer; throws if it runs past the end */
+class BinaryReader
+{
+    public:
+
+        BinaryReader(const std::string& buffer);
+
+        /** return the whole contents of a file, to read from; throws if it can't be opened */
+        static std::string readFile(const std::string& filename);
+
+        uint8_t readUInt8();
+        uint32_t readUInt32();
+        uint64_t readUInt64();
+        double readDouble();
+        uint64_t readVarint();
+        std::string readString();
+
+        /** true once every byte of the buffer has been read */
+        bool isAtEnd();
+
+    private:
+
+        /** throw unless there are this many bytes left to read */
+        void require(size_t bytes);
+
+        const std::string& buffer;
+        size_t position;
+};
\ No newline at end of file
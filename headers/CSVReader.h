@@ -10,7 +10,7 @@ class CSVReader
     public:
         CSVReader();
 
-        static std::vector<OrderBookEntry> readCSV(std::string csvFile);
+        static std::vector<OrderBookEntry> readCSV(const std::string& csvFile);
         static std::vector<std::string> tokenise(std::string csvLine, char separator);
         static OrderBookEntry stringsToOBE(
             std::string price, 
@@ -20,6 +20,10 @@ class CSVReader
             OrderBookType orderType
         );
 
+        /** parse a whole field as a non-negative integer; surrounding spaces are allowed, but a sign or
+         *  anything else trailing throws rather than wrapping around or being cut off */
+        static uint64_t stringToUnsigned(std::string value);
+
     private:
         static OrderBookEntry stringsToOBE(std::vector<std::string> strings);
 };
\ No newline at end of file
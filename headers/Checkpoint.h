@@ -0,0 +1,56 @@
+
+#pragma once
+
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <cstdint>
+
+/** everything needed to resume a simulation without replaying it from the start */
+struct SimulationState
+{
+    std::string currentTime;
+    uint64_t timeframesProcessed;
+    uint64_t salesProcessed;
+    std::vector<OrderBookEntry> userOrders;
+    std::map<std::string, double> balances;
+
+    /** every agent's balances, agent by agent, in the order of agentCurrencies */
+    std::vector<std::string> agentCurrencies;
+    std::vector<double> agentBalances;
+
+    /** indicator windows as written by IndicatorEngine::save() */
+    std::string indicators;
+};
+
+class Checkpoint
+{
+    public:
+
+        Checkpoint();
+
+        /** waits for any write still in flight */
+        ~Checkpoint();
+
+        /** encode the state into a compact binary buffer */
+        static std::string serialize(SimulationState& state);
+
+        /** decode a buffer made by serialize(); throws on a malformed or foreign buffer */
+        static SimulationState deserialize(const std::string& buffer);
+
+        /** write an already serialized buffer to disk on a background thread, so the
+         *  caller only pays for the snapshot. Waits for the previous write first */
+        void writeAsync(const std::string& filename, std::string buffer);
+
+        /** block until the last write is on disk */
+        void wait();
+
+    private:
+
+        /** write to a temporary file and rename it over the target, so a crash mid-write keeps the old checkpoint */
+        static void writeFile(const std::string& filename, const std::string& buffer);
+
+        std::thread writer;
+};
\ No newline at end of file
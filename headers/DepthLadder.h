@@ -0,0 +1,58 @@
+
+#pragma once
+
+#include "OrderBookEntry.h"
+#include "OrderView.h"
+#include <vector>
+
+/** one aggregated price level; cumulative fields include every level up to and including this one */
+struct DepthLevel
+{
+    double price;
+    double amount;
+    double cumulativeAmount;
+    double cumulativeNotional;
+};
+
+/** L2 view of one side of a product's book, aggregated by price and kept as prefix sums */
+class DepthLadder
+{
+    public:
+
+        DepthLadder();
+
+        /** aggregate a series of asks or bids into price levels, best price first */
+        void build(const OrderView& orders, OrderBookType side);
+
+        /** return total amount available at the given price or better; O(log n) */
+        double getVolumeUpTo(double price);
+
+        /** return total notional (amount * price) available at the given price or better; O(log n) */
+        double getNotionalUpTo(double price);
+
+        /** return the average price paid to fill this quantity by walking the ladder;
+         *  returns 0 if the ladder does not hold enough volume. O(log n) */
+        double getAverageFillPrice(double quantity);
+
+        /** return the best n levels of the ladder */
+        std::vector<DepthLevel> getTopLevels(unsigned int n);
+
+        /** return the best price of the ladder; 0 if it is empty */
+        double getBestPrice();
+
+        /** return the sum of the amounts of all levels */
+        double getTotalAmount();
+
+        bool isEmpty();
+
+    private:
+
+        /** asks improve as they go down in price, bids as they go up */
+        bool isBetterPrice(double price, double than);
+
+        /** return the number of levels priced at the given price or better */
+        unsigned int countLevelsUpTo(double price);
+
+        OrderBookType side;
+        std::vector<DepthLevel> levels;
+};
\ No newline at end of file
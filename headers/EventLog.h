@@ -0,0 +1,94 @@
+
+#pragma once
+
+#include "OrderCommand.h"
+#include "BinaryIO.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <unordered_map>
+#include <cstdint>
+
+enum class EventType{datasetOrder = 1, deposit, command, spawnAgents, agentOrders, advance, restore};
+
+/** one input to the simulation. Which fields are used depends on the type:
+ *  datasetOrder uses command.order; command the whole command, as it was drained;
+ *  deposit currency and amount; spawnAgents agentCount and balances;
+ *  agentOrders firstOrderId, the first of the block of ids the agents took that timeframe;
+ *  restore the raw checkpoint it loaded; advance nothing */
+struct Event
+{
+    EventType type = EventType::advance;
+    uint64_t sequence = 0;
+
+    OrderCommand command;
+
+    std::string currency;
+    double amount = 0;
+
+    uint32_t agentCount = 0;
+    std::map<std::string, double> balances;
+
+    uint64_t firstOrderId = 0;
+
+    std::string checkpoint;
+};
+
+/** appends events to a log file, numbering them from 1. Repeated strings such as products,
+ *  timestamps and usernames are written once and referred to by id afterwards.
+ *  Events are buffered until flush() */
+class EventLogWriter
+{
+    public:
+
+        EventLogWriter();
+
+        /** flushes whatever is buffered */
+        ~EventLogWriter();
+
+        /** start a new log; a file already of that name is kept as filename.1, the one before it as
+         *  filename.2 and so on up to a few runs back. Returns false if the log can't be created */
+        bool open(const std::string& filename);
+
+        bool isOpen();
+
+        /** number the event and buffer it; does nothing if no log is open */
+        void append(Event& event);
+
+        void flush();
+
+        /** the sequence number of the last event appended */
+        uint64_t getSequence();
+
+    private:
+
+        void writeOrder(OrderBookEntry& order);
+        void writeText(const std::string& text);
+
+        std::ofstream file;
+        BinaryWriter buffer;
+        uint64_t sequence;
+        std::unordered_map<std::string, uint32_t> textIds;
+};
+
+/** reads a whole log written by EventLogWriter back event by event; throws if it is malformed */
+class EventLogReader
+{
+    public:
+
+        /** throws if the file can't be read or isn't an event log */
+        EventLogReader(const std::string& filename);
+
+        /** read the next event; returns false at the end of the log */
+        bool next(Event& event);
+
+    private:
+
+        OrderBookEntry readOrder();
+        std::string readText();
+
+        std::string contents;
+        BinaryReader reader;
+        std::vector<std::string> texts;
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <cstdint>
+
+/** every frame is a 32-bit little-endian payload length followed by the payload,
+ *  whose first byte is one of these */
+enum class GatewayMessageType : uint8_t
+{
+    /** client to gateway */
+    submit = 1,
+    cancel = 2,
+    amend = 3,
+    subscribe = 4,
+    walletQuery = 5,
+
+    /** gateway to client */
+    ack = 64,
+    marketData = 65,
+    walletReport = 66
+};
+
+enum class GatewayStatus : uint8_t{accepted, queueFull, badRequest};
+
+/** one decoded message; only the fields used by its type are encoded on the wire.
+ *  requestId is chosen by the client and echoed back, so requests can be pipelined */
+struct GatewayMessage
+{
+    GatewayMessageType type = GatewayMessageType::ack;
+    uint32_t requestId = 0;
+
+    /** submit, cancel, amend and ack */
+    uint64_t orderId = 0;
+    GatewayStatus status = GatewayStatus::accepted;
+
+    /** submit uses 0 for a bid and 1 for an ask */
+    uint8_t side = 0;
+    double price = 0;
+    double amount = 0;
+
+    /** submit; a TimeInForce value, and for good-till-time how many timeframes the order lives */
+    uint8_t timeInForce = 0;
+    uint32_t expiresAfter = 0;
+
+    /** submit, subscribe and marketData */
+    std::string product;
+
+    /** marketData */
+    std::string timestamp;
+    double bestBid = 0;
+    double bidDepth = 0;
+    double bestAsk = 0;
+    double askDepth = 0;
+
+    /** walletReport */
+    std::map<std::string, double> balances;
+};
+
+class GatewayProtocol
+{
+    public:
+
+        /** frames larger than this are treated as a broken connection */
+        static const uint32_t maxFrameSize = 64 * 1024;
+
+        /** encode a message into a complete length-prefixed frame */
+        static std::string encode(GatewayMessage& message);
+
+        /** decode a frame payload; throws if it is malformed */
+        static GatewayMessage decode(const std::string& payload);
+
+        /** if a complete frame starts at offset, copy its payload out, move offset past it and return true.
+         *  The caller erases consumed bytes once per read rather than once per frame.
+         *  Throws if the announced length is over maxFrameSize */
+        static bool extractFrame(const std::string& input, size_t& offset, std::string& payload);
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+
+#pragma once
+
+#include "RollingWindow.h"
+#include "BinaryIO.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/** the indicators of one product over one window length, as of the last timeframe */
+struct IndicatorValues
+{
+    double movingAverage = 0;
+    double exponentialAverage = 0;
+
+    /** standard deviation of the timeframe-to-timeframe price returns */
+    double volatility = 0;
+
+    /** (bid volume - ask volume) / (bid volume + ask volume), from -1 to 1 */
+    double imbalance = 0;
+
+    /** false until the window has seen as many timeframes as its length */
+    bool ready = false;
+};
+
+/** rolling indicators for every product over several window lengths at once.
+ *  Each update is O(1) per window thanks to ring buffers and running sums,
+ *  and reading the current values never looks at past timeframes */
+class IndicatorEngine
+{
+    public:
+
+        IndicatorEngine();
+
+        /** track a window of this many timeframes for every product; call before the first update */
+        void addWindow(unsigned int length);
+
+        std::vector<unsigned int> getWindows();
+
+        /** feed one timeframe of a product: its mid price and the volume on each side of the book.
+         *  A price of 0 means the book was empty and repeats the last price; before any price is seen it is ignored */
+        void update(const std::string& product, double price, double bidVolume, double askVolume);
+
+        /** return the current values; all zero for an unknown product or window */
+        IndicatorValues getValues(const std::string& product, unsigned int window);
+
+        void save(BinaryWriter& writer);
+
+        /** replace every product's state with what save() wrote; throws if the buffer is malformed */
+        void load(BinaryReader& reader);
+
+    private:
+
+        struct WindowState
+        {
+            RollingWindow prices;
+            RollingWindow returns;
+            RollingWindow bidVolumes;
+            RollingWindow askVolumes;
+            double exponentialAverage;
+        };
+
+        struct ProductState
+        {
+            double lastPrice = 0;
+            std::vector<WindowState> windows;
+        };
+
+        /** make the empty state for a product seen for the first time */
+        ProductState createProductState();
+
+        std::vector<unsigned int> windowLengths;
+        std::unordered_map<std::string, ProductState> products;
+};
\ No newline at end of file
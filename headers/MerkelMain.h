@@ -3,19 +3,32 @@
 #pragma once
 
 #include <vector>
+#include <map>
 #include "../headers/OrderBookEntry.h"
 #include "../headers/OrderBook.h"
 #include "../headers/Wallet.h"
+#include "../headers/Checkpoint.h"
+#include "../headers/OrderQueue.h"
+#include "../headers/OrderCommand.h"
+#include "../headers/OrderGateway.h"
+#include "../headers/AgentWalletStore.h"
+#include "../headers/IndicatorEngine.h"
+#include "../headers/EventLog.h"
 
 class MerkelMain
 {
     public:
 
-        MerkelMain();
+        /** without the dataset the book starts empty, ready for replay() */
+        MerkelMain(bool loadDataset = true);
 
         /** Call this to start the sim */
         void init();
 
+        /** rebuild the simulation from an event log as fast as possible, without output, and print
+         *  a digest of the final state; stops after lastSequence unless it is 0 */
+        void replay(const std::string& filename, uint64_t lastSequence);
+
     private:
 
         void printMenu();
@@ -24,15 +37,96 @@ class MerkelMain
         void printMarketStats();
         void enterAsk();
         void enterBid();
+
+        /** read the optional time in force and lifetime tokens of an ask or bid; throws on bad input */
+        void readTimeInForce(std::vector<std::string>& tokens, OrderBookEntry& obe);
         void printWallet();
+        void enterCancel();
+        void startGateway();
+        void spawnAgents();
+        void writeArchive();
+        void queryArchive();
+        void queryOrders();
         void goToNextTimeframe();
+        void saveCheckpoint();
+        void restoreCheckpoint();
+
+        /** print a hash of the whole simulation state, to tell whether a replay reached the same place */
+        void printStateDigest(uint64_t sequence);
         void exitApp();
         void processOption(int userOption);
 
+        /** give an order an id and queue it for the matching thread; returns false if the queue is full */
+        bool submitOrder(OrderBookEntry& order);
+
+        /** apply the commands waiting in the order queue to the book, in the order they arrived */
+        void processOrderQueue();
+
+        /** insert the accepted submits collected so far as one batch */
+        void flushSubmits(std::vector<OrderBookEntry>& accepted);
+
+        /** let every simulated agent place one immediate-or-cancel order against the current best prices */
+        void generateAgentOrders();
+
+        /** add funds to the user's wallet */
+        void deposit(const std::string& currency, double amount);
+
+        /** give agents starting with these balances to the simulation */
+        void addAgents(uint32_t count, std::map<std::string, double>& balances);
+
+        /** put a checkpoint's state in place of the current one */
+        void applyState(SimulationState& state);
+
+        /** snapshot everything a checkpoint keeps */
+        SimulationState captureState();
+
+        /** feed the product's book at the current time to the indicators */
+        void updateIndicators(const std::string& product);
+
+        /** send the new timeframe's top of book and the wallet to gateway clients */
+        void publishToGateway();
+
         std::string currentTime;
 
-        //OrderBook orderBook{"../data/20200317.csv"};
-        OrderBook orderBook{"../data/20200601.csv"};
+        //const std::string datasetFilename = "../data/20200317.csv";
+        const std::string datasetFilename = "../data/20200601.csv";
+        OrderBook orderBook{datasetFilename};
         
         Wallet wallet;
+
+        /** commands from any producer thread wait here until the next timeframe boundary */
+        OrderQueue<OrderCommand> orderQueue{4096};
+        const size_t orderBatchSize = 256;
+
+        /** lets external bots submit orders and read market data over a local socket */
+        OrderGateway gateway{orderQueue, orderBook};
+        const std::string gatewaySocketPath = "merkel.sock";
+
+        /** wallets of the simulated agents, settled once per timeframe */
+        AgentWalletStore agentWallets;
+
+        /** each agent trades this fraction of its holdings per order */
+        const double agentTradeFraction = 0.01;
+
+        /** rolling indicators per product, fed once per timeframe */
+        IndicatorEngine indicators;
+
+        /** compressed copy of the dataset for historical range queries */
+        const std::string archiveFilename = "orderbook.archive";
+
+        /** stats accumulated over the run, carried across checkpoints */
+        uint64_t timeframesProcessed = 0;
+        uint64_t salesProcessed = 0;
+
+        /** a checkpoint is taken every this many timeframes */
+        const uint64_t checkpointInterval = 100;
+        const std::string checkpointFilename = "merkel.checkpoint";
+        Checkpoint checkpoint;
+
+        /** every input to the simulation, in the order it was applied, so a run can be replayed */
+        EventLogWriter eventLog;
+        const std::string eventLogFilename = "merkel.eventlog";
+
+        /** set while replaying; nothing is logged or checkpointed then */
+        bool replaying = false;
 };
\ No newline at end of file
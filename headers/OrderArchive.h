@@ -0,0 +1,93 @@
+
+#pragma once
+
+#include "OrderBookEntry.h"
+#include "BinaryIO.h"
+#include <string>
+#include <vector>
+#include <fstream>
+
+/** a range query over an archive; an empty product or time and a zero price mean no bound on that side */
+struct ArchiveQuery
+{
+    std::string product;
+    std::string startTime;
+    std::string endTime;
+    double minPrice = 0;
+    double maxPrice = 0;
+};
+
+/** how much of the archive a query had to look at */
+struct ArchiveScanStats
+{
+    uint32_t chunksTotal = 0;
+    uint32_t chunksRead = 0;
+    uint64_t bytesRead = 0;
+    uint64_t rowsDecoded = 0;
+};
+
+/** compressed columnar archive of order book entries for historical range queries.
+ *  Rows are clustered by product and cut into chunks of up to chunkRows of a single product, in time order.
+ *  Each chunk stores its columns back to back: timestamps as varint deltas of microseconds,
+ *  prices as zigzag varint deltas of fixed-point values, sides as codes and amounts as fixed-point varints.
+ *  A footer indexes every chunk with its product, min/max zone maps for time and price, and its column lengths,
+ *  so queries only read chunks that can match, and within them only the columns some row still needs */
+class OrderArchive
+{
+    public:
+
+        static const uint32_t chunkRows = 1024;
+
+        /** write dataset orders, sorted by timestamp, to an archive file; returns its size in bytes.
+         *  Throws if the file can't be written or a timestamp doesn't parse */
+        static uint64_t write(const std::string& filename, std::vector<OrderBookEntry>& orders);
+
+        /** return every archived order matching the query, in time order; throws if the file is missing or malformed */
+        static std::vector<OrderBookEntry> query(const std::string& filename, const ArchiveQuery& query, ArchiveScanStats& stats);
+
+        /** convert between "YYYY/MM/DD HH:MM:SS.ffffff" and microseconds since 1970 */
+        static int64_t parseTimestamp(const std::string& timestamp);
+        static std::string formatTimestamp(int64_t micros);
+
+    private:
+
+        /** the columns of a chunk, in the order they are stored */
+        static const unsigned int timeColumnIndex = 0;
+        static const unsigned int priceColumnIndex = 1;
+        static const unsigned int sideColumnIndex = 2;
+        static const unsigned int amountColumnIndex = 3;
+        static const unsigned int columnCount = 4;
+
+        /** zone map and location of one chunk, as kept in the footer */
+        struct ChunkIndex
+        {
+            uint64_t offset;
+            uint32_t rows;
+            uint32_t product;
+            int64_t minTime;
+            int64_t maxTime;
+            int64_t minPrice;
+            int64_t maxPrice;
+            uint32_t columnLengths[columnCount];
+        };
+
+        /** encode the orders at rows[start, end), all of one product, as one chunk */
+        static std::string encodeChunk(
+            std::vector<OrderBookEntry>& orders,
+            std::vector<size_t>& rows,
+            size_t start,
+            size_t end,
+            ChunkIndex& index
+        );
+
+        /** read one column of a chunk from the archive; throws if the file is cut short */
+        static std::string readColumn(std::ifstream& file, ChunkIndex& index, unsigned int column, ArchiveScanStats& stats);
+
+        /** signed values are zigzagged so small negative deltas stay small */
+        static uint64_t zigzag(int64_t value);
+        static int64_t unzigzag(uint64_t value);
+
+        /** prices and amounts are kept as integers of 1e-8, the precision of the csv data */
+        static int64_t toFixed(double value);
+        static double fromFixed(int64_t value);
+};
\ No newline at end of file
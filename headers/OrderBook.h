@@ -3,45 +3,190 @@
 
 #include "OrderBookEntry.h"
 #include "CSVReader.h"
+#include "DepthLadder.h"
+#include "TimerWheel.h"
+#include "OrderArchive.h"
+#include "OrderView.h"
+#include "OrderQueryEngine.h"
 #include <string>
 #include <vector>
+#include <string_view>
+#include <map>
+#include <atomic>
+#include <limits>
+#include <unordered_map>
 
 class OrderBook
 {
     public:
-        /** construct, reading a csv data file */
-        OrderBook(std::string filename);
+        /** construct, reading a csv data file; an empty filename gives an empty book */
+        OrderBook(const std::string& filename);
         
-        /** return vector of all known products in the dataset */
-        std::vector<std::string> getKnownProducts();
+        /** return all known products in the dataset, sorted; kept up to date as orders are inserted */
+        const std::vector<std::string>& getKnownProducts();
 
-        /** return vector of Orders according to the sent filters */
+        /** return vector of Orders according to the sent filters; copies them, see viewOrders() */
         std::vector<OrderBookEntry> getOrders(
             OrderBookType type, 
-            std::string product, 
-            std::string timestamp
+            std::string_view product, 
+            std::string_view timestamp
         );
 
+        /** return the orders that can match in this product, side and timestamp in place, without copying them:
+         *  the dataset orders of the timestamp and every resting user order, as matchAsksToBids() sees them.
+         *  The view is invalidated by inserts, cancels and matching, and must not outlive product */
+        OrderView viewOrders(OrderBookType type, std::string_view product, std::string_view timestamp);
+
+        /** return every dataset order of a timestamp, found by binary search; invalidated like viewOrders() */
+        OrderSpan viewOrdersAt(std::string_view timestamp);
+
+        /** return every dataset order, in time order; invalidated like viewOrders() */
+        OrderSpan viewDatasetOrders();
+
         /** return earliest timestamp. Assumes data is ordered from earliest to latest */
-        std::string getEarliestTime();
+        const std::string& getEarliestTime();
 
         /** return timestamp after the one passed in; if there is no next one it will wrap around */
-        std::string getNextTime(std::string timestamp);
+        const std::string& getNextTime(std::string_view timestamp);
 
-        /** insert a new order into the OrderBook and sort it */
+        /** insert a new order into the OrderBook; dataset orders are kept sorted by timestamp */
         void insertOrder(OrderBookEntry& order);
+
+        /** insert a batch of orders, sorting the dataset orders once for the whole batch */
+        void insertOrders(std::vector<OrderBookEntry>& batch);
+
+        /** remove a user order; returns false if there is no order with that id */
+        bool cancelOrder(uint64_t orderId);
+
+        /** change the price and amount of a user order; returns false if there is no order with that id */
+        bool amendOrder(uint64_t orderId, double price, double amount);
+
+        /** return the user order with this id, or nullptr; the pointer is invalidated by inserts and cancels */
+        OrderBookEntry* findUserOrder(uint64_t orderId);
+
+        /** reserve fresh ids for user orders, count of them in a row, and return the first;
+         *  safe to call from any thread without touching the book */
+        uint64_t allocateOrderId(uint64_t count = 1);
+
+        /** never hand out an id below this one from now on; used when replaying a log */
+        void skipOrderIdsTo(uint64_t orderId);
         
-        /** match orders together and create sales */
-        std::vector<OrderBookEntry> matchAsksToBids(std::string product, std::string timestamp);
+        /** match the dataset orders of this timestamp and every resting user order of the product, and create sales.
+         *  User orders keep what is left of them, unless they are filled or their time in force ends with this match.
+         *  Fills between two dataset orders only become sales when journalDatasetSales is set */
+        std::vector<OrderBookEntry> matchAsksToBids(std::string_view product, std::string_view timestamp, bool journalDatasetSales = true);
+
+        /** remove and return the good-till-time orders whose expiry timeframe has been reached */
+        std::vector<OrderBookEntry> expireOrders(uint64_t timeframe);
+
+        /** return the user orders that left the book while matching since the last call, so their funds can be released */
+        std::vector<OrderBookEntry> takeClosedOrders();
+
+        /** return every order placed by a user rather than the dataset */
+        std::vector<OrderBookEntry> getUserOrders();
+
+        /** drop all user orders and put these in their place, with the expiry clock at timeframe;
+         *  used when restoring a checkpoint */
+        void replaceUserOrders(std::vector<OrderBookEntry>& userOrders, uint64_t timeframe);
+
+        /** return the aggregated depth of one side of a product at a timestamp, resting user orders included;
+         *  ladders are cached for the current timestamp and rebuilt when orders change */
+        DepthLadder& getLadder(OrderBookType type, std::string_view product, std::string_view timestamp);
+
+        /** evaluate a filter over every order in the book, dataset and user, with count, sum, min and max
+         *  aggregated on the secondary indexes. The dataset is indexed on the first query after dataset orders
+         *  are inserted, and the user orders on the first query after any change; throws if the query's times don't parse */
+        OrderQueryResult queryOrders(const OrderQuery& query);
+
+        /** write the dataset orders to a compressed columnar archive; returns its size in bytes.
+         *  Throws if the file can't be written */
+        uint64_t writeArchive(const std::string& filename);
+
+        /** return the archived orders matching the query, reading only the chunks that can contain them.
+         *  Throws if the archive is missing or malformed */
+        static std::vector<OrderBookEntry> queryArchive(const std::string& filename, const ArchiveQuery& query, ArchiveScanStats& stats);
 
         /** return highest price in a series of orders */
         static double getHighPrice(std::vector<OrderBookEntry>& orders);
+        static double getHighPrice(const OrderView& orders);
         
         /** return lowest price in a series of orders */
         static double getLowPrice(std::vector<OrderBookEntry>& orders);
+        static double getLowPrice(const OrderView& orders);
 
 
     private:
 
+        /** add a user order, indexing it and scheduling its expiry */
+        void addUserOrder(OrderBookEntry& order);
+
+        /** remove a user order by swapping the last one into its place */
+        OrderBookEntry removeUserOrder(uint64_t orderId);
+
+        /** put what matching left of a user order back into the book, closing it if it is done */
+        void settleUserOrder(OrderBookEntry& matched);
+
+        /** add the sales resulting from a fill between this ask and bid; sales happen at the ask price */
+        static void recordSales(
+            std::vector<OrderBookEntry>& sales, 
+            OrderBookEntry& ask, 
+            OrderBookEntry& bid, 
+            double amount, 
+            std::string_view timestamp
+        );
+
+        /** the matching loop, specialized at compile time on what is matched and whether dataset fills are
+         *  recorded, so each kind of timeframe runs without the checks the others need; see OrderBook.cpp */
+        template <typename BookPolicy, typename JournalPolicy>
+        std::vector<OrderBookEntry> matchKernel(std::string_view product, std::string_view timestamp);
+
+        /** fill sorted asks against sorted bids in price priority, leaving what is unfilled of each in place */
+        template <typename BookPolicy, typename JournalPolicy>
+        static void fillOrders(
+            std::vector<typename BookPolicy::Order>& asks,
+            std::vector<typename BookPolicy::Order>& bids,
+            std::vector<OrderBookEntry>& sales,
+            std::string_view product,
+            std::string_view timestamp
+        );
+
+        /** note that the orders changed, dropping the cached depth and making the query indexes stale */
+        void markChanged();
+
+        /** add any products of these orders that aren't known yet */
+        void addKnownProducts(const OrderBookEntry* first, const OrderBookEntry* last);
+
         std::vector<OrderBookEntry> orders;
+
+        /** sorted product names of every order ever inserted */
+        std::vector<std::string> knownProducts;
+
+        /** orders placed by users, in no particular order. Kept apart from the dataset so
+         *  inserting, cancelling and checkpointing them never touches the large sorted vector */
+        std::vector<OrderBookEntry> userOrders;
+
+        /** position of each user order in userOrders, by id */
+        std::unordered_map<uint64_t, size_t> userOrderIndex;
+
+        /** user orders that left the book while matching, waiting for takeClosedOrders() */
+        std::vector<OrderBookEntry> closedOrders;
+
+        /** drives good-till-time expiries on the timeframe clock */
+        TimerWheel expiryWheel;
+
+        std::atomic<uint64_t> nextOrderId;
+
+        /** ladders built for ladderTimestamp, keyed by product and then side;
+         *  the transparent comparator lets a string_view find a product without building a string */
+        std::map<std::string, std::map<OrderBookType, DepthLadder>, std::less<>> ladders;
+        std::string ladderTimestamp;
+
+        /** bumped on every change to the orders, and on inserts into the dataset respectively;
+         *  each query index is rebuilt when it falls behind its counter */
+        uint64_t revision = 0;
+        uint64_t datasetRevision = 0;
+        uint64_t indexedRevision = std::numeric_limits<uint64_t>::max();
+        uint64_t indexedDatasetRevision = std::numeric_limits<uint64_t>::max();
+        OrderQueryEngine datasetQueries;
+        OrderQueryEngine userQueries;
 };
\ No newline at end of file
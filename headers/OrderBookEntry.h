@@ -3,10 +3,16 @@
 #pragma once
 
 #include <iostream>
+#include <cstdint>
 
 /** unknown type added for strings that don't conform; should throw exception instead */
 enum class OrderBookType{bid, ask, bidsale, asksale, unknown};
 
+/** how long a user order may rest in the book:
+ *  gtc until filled or cancelled, ioc matches once and drops the rest,
+ *  fok matches only if it can be filled completely, gtt rests until its expiry timeframe */
+enum class TimeInForce{gtc, ioc, fok, gtt};
+
 /** Class specification without implementation
  */
 class OrderBookEntry
@@ -21,9 +27,12 @@ class OrderBookEntry
                         std::string username = "dataset" ); //default to dataset for all the orders from the csv data
 
         static OrderBookType stringToOrderBookType(std::string s);
-        static bool compareByTimestamp(OrderBookEntry& e1, OrderBookEntry& e2);
-        static bool compareByPriceAsc(OrderBookEntry& e1, OrderBookEntry& e2);
-        static bool compareByPriceDesc(OrderBookEntry& e1, OrderBookEntry& e2);
+
+        /** parses "GTC", "IOC", "FOK" or "GTT"; throws on anything else */
+        static TimeInForce stringToTimeInForce(std::string s);
+        static bool compareByTimestamp(const OrderBookEntry& e1, const OrderBookEntry& e2);
+        static bool compareByPriceAsc(const OrderBookEntry& e1, const OrderBookEntry& e2);
+        static bool compareByPriceDesc(const OrderBookEntry& e1, const OrderBookEntry& e2);
 
         double price;
         double amount;
@@ -31,4 +40,16 @@ class OrderBookEntry
         std::string product;
         OrderBookType orderType;
         std::string username;
+
+        /** assigned by the OrderBook to user orders so they can be cancelled or amended; 0 for dataset orders */
+        uint64_t orderId;
+
+        /** only meaningful for user orders; dataset orders always match in their own timeframe */
+        TimeInForce timeInForce;
+
+        /** timeframe at which a gtt order expires */
+        uint64_t expiresAt;
+
+        /** simulated agent that owns the order, settled in the AgentWalletStore; 0 for the dataset and the interactive user */
+        uint32_t agentId;
 };
\ No newline at end of file
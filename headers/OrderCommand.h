@@ -0,0 +1,30 @@
+
+#pragma once
+
+#include "OrderBookEntry.h"
+
+enum class OrderCommandType{submit, cancel, amend};
+
+/** a request to change the book, queued by producers and applied by the matching thread.
+ *  submit carries the whole order; cancel only needs order.orderId; amend uses order.orderId,
+ *  order.price and order.amount. Producers don't know the timeframe clock, so a good-till-time
+ *  submit carries in order.expiresAt how many timeframes it should live, made absolute when applied */
+struct OrderCommand
+{
+    OrderCommand()
+    :   type(OrderCommandType::submit),
+        order{0, 0, "", "", OrderBookType::unknown}
+    {
+
+    }
+
+    OrderCommand(OrderCommandType _type, OrderBookEntry _order)
+    :   type(_type),
+        order(_order)
+    {
+
+    }
+
+    OrderCommandType type;
+    OrderBookEntry order;
+};
\ No newline at end of file
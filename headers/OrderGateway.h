@@ -0,0 +1,91 @@
+
+#pragma once
+
+#include "OrderBook.h"
+#include "OrderQueue.h"
+#include "OrderCommand.h"
+#include "GatewayProtocol.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+/** serves external bots over a Unix-domain socket using the GatewayProtocol frames.
+ *  An epoll loop on its own thread reads every pipelined request a client has sent,
+ *  pushes orders onto the shared order queue and answers with one batched write.
+ *  Only available on Linux; start() reports failure elsewhere */
+class OrderGateway
+{
+    public:
+
+        /** the order book is only used to hand out order ids, which never locks it */
+        OrderGateway(OrderQueue<OrderCommand>& orderQueue, OrderBook& orderBook);
+
+        ~OrderGateway();
+
+        /** bind the socket and start the event loop thread; returns false if it couldn't */
+        bool start(const std::string& socketPath);
+
+        /** stop the event loop, close every connection and remove the socket file */
+        void stop();
+
+        bool isRunning();
+
+        /** send a market data update to every client subscribed to its product; called by the matching thread */
+        void publishMarketData(GatewayMessage& update);
+
+        /** replace the balances that wallet queries are answered with; called by the matching thread */
+        void publishWallet(std::map<std::string, double> balances);
+
+        /** requests handled since start */
+        uint64_t getRequestCount();
+
+    private:
+
+        struct Connection
+        {
+            std::string input;
+            std::string output;
+            std::set<std::string> subscriptions;
+            bool wantsWrite = false;
+        };
+
+        void runLoop();
+        void acceptClients();
+        void readClient(int fd);
+        void writeClient(int fd);
+        void closeClient(int fd);
+
+        /** turn one request into a response appended to the connection's output */
+        void handleRequest(Connection& connection, GatewayMessage& request);
+
+        /** move market data handed over by the matching thread into subscriber outputs */
+        void deliverMarketData();
+
+        /** watch a client for writability only while it has output waiting */
+        void updateInterest(int fd, Connection& connection);
+
+        OrderQueue<OrderCommand>& orderQueue;
+        OrderBook& orderBook;
+
+        std::string socketPath;
+        int listenFd;
+        int epollFd;
+
+        /** written to by other threads to wake the event loop */
+        int wakeFd;
+
+        std::thread loop;
+        std::atomic<bool> running;
+        std::atomic<uint64_t> requestCount;
+
+        std::map<int, Connection> connections;
+
+        /** state handed over from the matching thread */
+        std::mutex publishMutex;
+        std::vector<GatewayMessage> pendingMarketData;
+        std::map<std::string, double> walletSnapshot;
+};
\ No newline at end of file
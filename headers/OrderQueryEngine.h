@@ -0,0 +1,97 @@
+
+#pragma once
+
+#include "OrderBookEntry.h"
+#include "OrderView.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/** a compound filter over the order history; empty strings, zero prices and an unknown side mean any */
+struct OrderQuery
+{
+    std::string product;
+    OrderBookType type = OrderBookType::unknown;
+    std::string owner;
+    std::string startTime;
+    std::string endTime;
+    double minPrice = 0;
+    double maxPrice = 0;
+
+    /** how many of the matching orders to return alongside the aggregates */
+    size_t rowLimit = 0;
+};
+
+/** aggregates over every matching order, computed without copying any of them */
+struct OrderQueryResult
+{
+    uint64_t count = 0;
+    double totalAmount = 0;
+    double totalNotional = 0;
+    double minPrice = 0;
+    double maxPrice = 0;
+
+    /** the first rowLimit matching orders, in time order */
+    std::vector<OrderBookEntry> rows;
+};
+
+/** secondary indexes over a snapshot of the book for ad-hoc history queries.
+ *  Rows are kept in time order so a time range is a binary search, each product has its rows
+ *  sorted by price, and side and owner have one bitmap per value. A query picks the narrower of
+ *  the time and price ranges to seed a candidate bitmap, then intersects the side and owner bitmaps
+ *  a word at a time, and aggregates straight off the columns */
+class OrderQueryEngine
+{
+    public:
+
+        OrderQueryEngine();
+
+        /** index these orders, replacing what was indexed before. The engine keeps pointers to them,
+         *  so it must be rebuilt before querying once they are changed; throws if a timestamp doesn't parse */
+        void build(OrderSpan orders);
+
+        /** evaluate a query against the indexed orders; throws if its times don't parse */
+        OrderQueryResult run(const OrderQuery& query);
+
+        /** merge the results of one query run on two engines over separate orders */
+        static OrderQueryResult combine(OrderQueryResult& first, OrderQueryResult& second, size_t rowLimit);
+
+    private:
+
+        /** rows of one product sorted by price, with the prices alongside for binary search */
+        struct PriceIndex
+        {
+            std::vector<double> prices;
+            std::vector<uint32_t> rows;
+        };
+
+        typedef std::vector<uint64_t> Bitmap;
+
+        /** return the id of a dictionary value, adding it if it is new */
+        static uint32_t intern(
+            const std::string& value,
+            std::vector<std::string>& names,
+            std::unordered_map<std::string, uint32_t>& ids
+        );
+
+        /** set a row's bit, growing the bitmap as needed */
+        static void setBit(Bitmap& bitmap, uint32_t row);
+
+        /** columns, one entry per row, in time order */
+        std::vector<int64_t> times;
+        std::vector<double> prices;
+        std::vector<double> amounts;
+        std::vector<uint32_t> productIds;
+        std::vector<const OrderBookEntry*> sources;
+
+        std::vector<std::string> products;
+        std::unordered_map<std::string, uint32_t> productIndex;
+        std::vector<std::string> owners;
+        std::unordered_map<std::string, uint32_t> ownerIndex;
+
+        std::vector<PriceIndex> priceIndexes;
+
+        /** indexed by OrderBookType and by owner id */
+        std::vector<Bitmap> sideBitmaps;
+        std::vector<Bitmap> ownerBitmaps;
+};
\ No newline at end of file
@@ -0,0 +1,192 @@
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/** bounded lock-free queue for many producer threads and a single consumer.
+ *  Each slot carries a sequence number telling producers and the consumer whose turn it is,
+ *  so producers only ever race on a compare-and-swap of the enqueue position.
+ *  Templates have to live in the header, so the whole implementation is here */
+template <typename T>
+class OrderQueue
+{
+    public:
+
+        /** capacity is rounded up to a power of two */
+        OrderQueue(size_t capacity);
+
+        /** add an item from any thread; returns false if the queue is full so the producer can back off */
+        bool tryPush(const T& item);
+
+        /** take the oldest item; consumer thread only */
+        bool tryPop(T& item);
+
+        /** move up to maxItems into out; consumer thread only. Returns how many were taken */
+        size_t drain(std::vector<T>& out, size_t maxItems);
+
+        /** number of items waiting; approximate while producers are active */
+        size_t getDepth();
+
+        size_t getCapacity();
+
+        /** highest depth the consumer has seen while draining */
+        size_t getHighWatermark();
+
+        /** total items accepted and turned away since construction */
+        uint64_t getPushedCount();
+        uint64_t getRejectedCount();
+
+    private:
+
+        struct Slot
+        {
+            std::atomic<size_t> sequence;
+            T item;
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        size_t mask;
+
+        /** keep the producer and consumer positions on separate cache lines */
+        alignas(64) std::atomic<size_t> enqueuePosition;
+        alignas(64) std::atomic<size_t> dequeuePosition;
+
+        alignas(64) std::atomic<uint64_t> pushedCount;
+        std::atomic<uint64_t> rejectedCount;
+        size_t highWatermark;
+};
+
+template <typename T>
+OrderQueue<T>::OrderQueue(size_t capacity)
+:   enqueuePosition(0),
+    dequeuePosition(0),
+    pushedCount(0),
+    rejectedCount(0),
+    highWatermark(0)
+{
+    size_t size = 2;
+
+    while (size < capacity)
+        size *= 2;
+
+    slots.reset(new Slot[size]);
+    mask = size - 1;
+
+    /** a slot is free for the producer whose position matches its sequence */
+    for (size_t i = 0; i < size; i++)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+bool OrderQueue<T>::tryPush(const T& item)
+{
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        Slot& slot = slots[position & mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        /** slot is free; claim it by moving the enqueue position on */
+        if (difference == 0)
+        {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.item = item;
+                slot.sequence.store(position + 1, std::memory_order_release);
+                pushedCount.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        /** the consumer hasn't freed this slot yet: the queue is full */
+        else if (difference < 0)
+        {
+            rejectedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        /** another producer got here first; try again from the new position */
+        else position = enqueuePosition.load(std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+bool OrderQueue<T>::tryPop(T& item)
+{
+    size_t position = dequeuePosition.load(std::memory_order_relaxed);
+    Slot& slot = slots[position & mask];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+    /** the producer for this slot hasn't finished writing it */
+    if (sequence != position + 1)
+        return false;
+
+    item = std::move(slot.item);
+
+    /** hand the slot back to producers one lap ahead */
+    slot.sequence.store(position + mask + 1, std::memory_order_release);
+    dequeuePosition.store(position + 1, std::memory_order_relaxed);
+    return true;
+}
+
+template <typename T>
+size_t OrderQueue<T>::drain(std::vector<T>& out, size_t maxItems)
+{
+    size_t depth = getDepth();
+
+    if (depth > highWatermark)
+        highWatermark = depth;
+
+    size_t taken = 0;
+    T item;
+
+    while (taken < maxItems && tryPop(item))
+    {
+        out.push_back(std::move(item));
+        taken++;
+    }
+
+    return taken;
+}
+
+template <typename T>
+size_t OrderQueue<T>::getDepth()
+{
+    size_t dequeued = dequeuePosition.load(std::memory_order_relaxed);
+    size_t enqueued = enqueuePosition.load(std::memory_order_relaxed);
+
+    /** positions are read separately, so guard against a stale enqueue position */
+    if (enqueued < dequeued)
+        return 0;
+
+    return enqueued - dequeued;
+}
+
+template <typename T>
+size_t OrderQueue<T>::getCapacity()
+{
+    return mask + 1;
+}
+
+template <typename T>
+size_t OrderQueue<T>::getHighWatermark()
+{
+    return highWatermark;
+}
+
+template <typename T>
+uint64_t OrderQueue<T>::getPushedCount()
+{
+    return pushedCount.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+uint64_t OrderQueue<T>::getRejectedCount()
+{
+    return rejectedCount.load(std::memory_order_relaxed);
+}
\ No newline at end of file
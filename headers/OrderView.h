@@ -0,0 +1,159 @@
+
+#pragma once
+
+#include "OrderBookEntry.h"
+#include <string_view>
+#include <cstddef>
+#include <iterator>
+
+/** a contiguous run of orders inside the book, iterated in place without copying.
+ *  Like any pointer into a vector, it is invalidated when orders are inserted or removed */
+class OrderSpan
+{
+    public:
+
+        OrderSpan()
+        :   first(nullptr),
+            last(nullptr)
+        {
+
+        }
+
+        OrderSpan(const OrderBookEntry* _first, const OrderBookEntry* _last)
+        :   first(_first),
+            last(_last)
+        {
+
+        }
+
+        const OrderBookEntry* begin() const { return first; }
+        const OrderBookEntry* end() const { return last; }
+
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+
+        const OrderBookEntry& operator[](size_t i) const { return first[i]; }
+
+    private:
+
+        const OrderBookEntry* first;
+        const OrderBookEntry* last;
+};
+
+/** the orders of one product and side that can match at one timestamp: the dataset slice of that
+ *  timestamp, followed by every resting user order, whenever it was placed. Iterating skips the others
+ *  in place, so nothing is copied; the product viewed must outlive the view */
+class OrderView
+{
+    public:
+
+        class iterator
+        {
+            public:
+
+                typedef std::forward_iterator_tag iterator_category;
+                typedef OrderBookEntry value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const OrderBookEntry* pointer;
+                typedef const OrderBookEntry& reference;
+
+                iterator(const OrderView* _view, const OrderBookEntry* _current, bool _inDataset)
+                :   view(_view),
+                    current(_current),
+                    inDataset(_inDataset)
+                {
+                    skipToMatch();
+                }
+
+                const OrderBookEntry& operator*() const { return *current; }
+                const OrderBookEntry* operator->() const { return current; }
+
+                iterator& operator++()
+                {
+                    ++current;
+                    skipToMatch();
+                    return *this;
+                }
+
+                iterator operator++(int)
+                {
+                    iterator previous = *this;
+                    ++*this;
+                    return previous;
+                }
+
+                bool operator==(const iterator& other) const { return current == other.current && inDataset == other.inDataset; }
+                bool operator!=(const iterator& other) const { return (*this == other) == false; }
+
+            private:
+
+                /** move forward to the next order the view selects, stepping from the dataset into the user orders */
+                void skipToMatch()
+                {
+                    while (true)
+                    {
+                        if (inDataset && current == view->dataset.end())
+                        {
+                            current = view->user.begin();
+                            inDataset = false;
+                        }
+
+                        if (inDataset == false && current == view->user.end())
+                            return;
+
+                        if (view->matches(*current))
+                            return;
+
+                        ++current;
+                    }
+                }
+
+                const OrderView* view;
+                const OrderBookEntry* current;
+                bool inDataset;
+        };
+
+        OrderView(
+            OrderSpan _dataset,
+            OrderSpan _user,
+            OrderBookType _type,
+            std::string_view _product
+        )
+        :   dataset(_dataset),
+            user(_user),
+            type(_type),
+            product(_product)
+        {
+
+        }
+
+        iterator begin() const { return iterator{this, dataset.begin(), true}; }
+        iterator end() const { return iterator{this, user.end(), false}; }
+
+        bool empty() const { return begin() == end(); }
+
+        /** walks the view; there is no stored count */
+        size_t count() const
+        {
+            size_t total = 0;
+
+            for (iterator it = begin(); it != end(); ++it)
+                total++;
+
+            return total;
+        }
+
+    private:
+
+        /** dataset orders are already limited to the timestamp, and user orders rest across timeframes,
+         *  so only the side and product are left to check */
+        bool matches(const OrderBookEntry& order) const
+        {
+            return order.orderType == type && order.product == product;
+        }
+
+        OrderSpan dataset;
+        OrderSpan user;
+        OrderBookType type;
+        std::string_view product;
+};
\ No newline at end of file
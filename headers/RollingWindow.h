@@ -0,0 +1,40 @@
+
+#pragma once
+
+#include "BinaryIO.h"
+#include <vector>
+
+/** the last N values of a series in a ring buffer, with a running sum and sum of squares
+ *  so the mean and variance come out in O(1) however long the window is */
+class RollingWindow
+{
+    public:
+
+        RollingWindow(unsigned int length = 1);
+
+        /** add a value, dropping the oldest one once the window is full */
+        void push(double value);
+
+        bool isFull();
+        unsigned int getCount();
+        unsigned int getLength();
+
+        double getSum();
+        double getMean();
+
+        /** population variance of the values in the window */
+        double getVariance();
+
+        void save(BinaryWriter& writer);
+
+        /** read back a window written by save(); throws if the buffer is short */
+        void load(BinaryReader& reader);
+
+    private:
+
+        std::vector<double> values;
+        unsigned int next;
+        unsigned int count;
+        double sum;
+        double sumSquares;
+};
\ No newline at end of file
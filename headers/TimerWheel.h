@@ -0,0 +1,52 @@
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+/** hierarchical timer wheel keyed on the integer timeframe clock.
+ *  Level 0 has one slot per tick; each level above covers 64 times the span of the one below,
+ *  and its slots are cascaded down as the clock reaches them. Advancing the clock costs
+ *  O(timers that fire) plus the occasional cascade, however many timers are waiting.
+ *  Timers are never removed early; callers check fired ids against their own state */
+class TimerWheel
+{
+    public:
+
+        TimerWheel();
+
+        /** fire id once the clock reaches expiry; expiries in the past fire on the next advance */
+        void schedule(uint64_t id, uint64_t expiry);
+
+        /** move the clock forward to now, appending the ids of every timer that fired to expired */
+        void advance(uint64_t now, std::vector<uint64_t>& expired);
+
+        /** drop every timer and restart the clock at tick */
+        void reset(uint64_t tick);
+
+    private:
+
+        struct Timer
+        {
+            uint64_t id;
+            uint64_t expiry;
+        };
+
+        static const unsigned int slotBits = 6;
+        static const unsigned int slotsPerLevel = 1 << slotBits;
+        static const unsigned int levelCount = 4;
+
+        /** put a timer in the lowest level whose span reaches its expiry */
+        void place(Timer timer);
+
+        /** re-place every timer of a higher level's slot, or of the overflow, into the levels below,
+         *  firing the ones that are due at the current tick */
+        void cascade(std::vector<Timer>& source, std::vector<uint64_t>& expired);
+
+        std::vector<Timer> slots[levelCount][slotsPerLevel];
+
+        /** timers further away than the top level reaches */
+        std::vector<Timer> overflow;
+
+        uint64_t currentTick;
+};
\ No newline at end of file
@@ -12,19 +12,40 @@ class Wallet
         Wallet();
 
         /** insert currency to the wallet */
-        void insertCurrency(std::string type, double amount);
+        void insertCurrency(const std::string& type, double amount);
 
         /** remove currency from the wallet */
-        bool removeCurrency(std::string type, double amount);
+        bool removeCurrency(const std::string& type, double amount);
 
         /** check if the wallet contains this much funds or more */
-        bool containsCurrency(std::string type, double amount);
+        bool containsCurrency(const std::string& type, double amount);
 
         /** check if the wallet can cope with this ask or bid */
-        bool canFulfillOrder(OrderBookEntry order);
+        bool canFulfillOrder(const OrderBookEntry& order);
 
-        /** adds or takes funds resulting from a sale, and assumes it was made by the owner of the wallet */
-        void processSale(OrderBookEntry sale);
+        /** adds or takes funds resulting from a sale, and assumes it was made by the owner of the wallet;
+         *  the filled part of the order's reservation is released */
+        void processSale(const OrderBookEntry& sale);
+
+        /** set aside the funds an order may spend so they can't be promised twice;
+         *  returns false if they aren't available or the order's price or amount isn't valid */
+        bool reserveOrder(OrderBookEntry& order);
+
+        /** true if an order's price and amount are finite and above zero; anything else would let
+         *  a reservation or a fill add funds instead of taking them. Every entry point checks orders with it */
+        static bool hasValidQuantities(double price, double amount);
+
+        /** hand back whatever is still set aside for this order; used when it is filled, cancelled or expires */
+        void releaseOrder(uint64_t orderId);
+
+        /** forget every reservation, e.g. before rebuilding them from restored orders */
+        void clearReservations();
+
+        /** return every currency held and its balance */
+        std::map<std::string, double> getBalances();
+
+        /** replace the whole contents of the wallet; used when restoring a checkpoint */
+        void setBalances(std::map<std::string, double> balances);
 
         /** print the contents of the wallet in a string representation */
         std::string toString();
@@ -32,5 +53,21 @@ class Wallet
 
     private:
 
+        /** work out which currency an order spends and how much of it; false for non ask/bid orders */
+        static bool getOrderCost(const OrderBookEntry& order, std::string& currency, double& amount, double& perUnit);
+
+        struct Reservation
+        {
+            std::string currency;
+
+            /** funds set aside per unit of the order's amount: 1 for asks, the limit price for bids */
+            double perUnit;
+            double remaining;
+        };
+
         std::map<std::string, double> currencies;
+
+        /** funds held back per currency, and which order holds them */
+        std::map<std::string, double> reserved;
+        std::map<uint64_t, Reservation> reservations;
 };
\ No newline at end of file
@@ -0,0 +1,294 @@
+
+#include "../headers/AgentWalletStore.h"
+#include "../headers/CSVReader.h"
+
+/** below this many fills, waking the workers costs more than it saves */
+static const size_t PARALLEL_SETTLE_THRESHOLD = 4096;
+
+AgentWalletStore::AgentWalletStore(unsigned int shardCount)
+:   agentCount(0),
+    settleGeneration(0),
+    workersBusy(0),
+    stopping(false)
+{
+    if (shardCount == 0)
+        shardCount = std::thread::hardware_concurrency();
+
+    if (shardCount == 0)
+        shardCount = 1;
+
+    shards.resize(shardCount);
+    changes.resize(shardCount);
+}
+
+AgentWalletStore::~AgentWalletStore()
+{
+    {
+        std::lock_guard<std::mutex> lock{settleMutex};
+        stopping = true;
+    }
+
+    settleStarted.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+uint32_t AgentWalletStore::addAgents(uint32_t count, std::map<std::string, double>& initialBalances)
+{
+    /** make sure every currency has a column before any rows are added */
+    for (std::pair<const std::string, double>& balance : initialBalances)
+        getCurrencyIndex(balance.first);
+
+    uint32_t firstId = agentCount + 1;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t agentId = ++agentCount;
+        Shard& shard = getShard(agentId);
+
+        shard.agentCount++;
+        shard.balances.resize(shard.agentCount * currencies.size(), 0);
+
+        double* row = &shard.balances[getRow(agentId) * currencies.size()];
+
+        for (std::pair<const std::string, double>& balance : initialBalances)
+            row[currencyIndex[balance.first]] = balance.second;
+    }
+
+    return firstId;
+}
+
+uint32_t AgentWalletStore::getAgentCount()
+{
+    return agentCount;
+}
+
+double AgentWalletStore::getBalance(uint32_t agentId, const std::string& currency)
+{
+    std::unordered_map<std::string, unsigned int>::iterator column = currencyIndex.find(currency);
+
+    if (agentId == 0 || agentId > agentCount || column == currencyIndex.end())
+        return 0;
+
+    return getShard(agentId).balances[getRow(agentId) * currencies.size() + column->second];
+}
+
+bool AgentWalletStore::canFulfillOrder(const OrderBookEntry& order)
+{
+    std::pair<unsigned int, unsigned int> columns = getProductCurrencies(order.product);
+
+    if (order.orderType == OrderBookType::ask)
+        return getBalance(order.agentId, currencies[columns.first]) >= order.amount;
+
+    if (order.orderType == OrderBookType::bid)
+        return getBalance(order.agentId, currencies[columns.second]) >= order.amount * order.price;
+
+    return false;
+}
+
+void AgentWalletStore::settle(std::vector<OrderBookEntry>& sales)
+{
+    /** the lists keep their capacity from the last batch */
+    for (std::vector<BalanceChange>& shardChanges : changes)
+        shardChanges.clear();
+
+    /** work out every balance change up front; this may add currency columns, which the threads must not do */
+    for (OrderBookEntry& sale : sales)
+    {
+        if (sale.agentId == 0 || sale.agentId > agentCount)
+            continue;
+
+        std::pair<unsigned int, unsigned int> columns = getProductCurrencies(sale.product);
+        std::vector<BalanceChange>& shardChanges = changes[(sale.agentId - 1) % shards.size()];
+        uint32_t row = getRow(sale.agentId);
+        double notional = sale.amount * sale.price;
+
+        /** agent sold: gives away the first currency for the second */
+        if (sale.orderType == OrderBookType::asksale)
+        {
+            shardChanges.push_back(BalanceChange{row, columns.first, -sale.amount});
+            shardChanges.push_back(BalanceChange{row, columns.second, notional});
+        }
+
+        /** agent bought: pays with the second currency for the first */
+        else if (sale.orderType == OrderBookType::bidsale)
+        {
+            shardChanges.push_back(BalanceChange{row, columns.first, sale.amount});
+            shardChanges.push_back(BalanceChange{row, columns.second, -notional});
+        }
+    }
+
+    if (sales.size() < PARALLEL_SETTLE_THRESHOLD || shards.size() == 1)
+    {
+        for (size_t s = 0; s < shards.size(); s++)
+            settleShard(s);
+
+        return;
+    }
+
+    if (workers.empty())
+    {
+        for (size_t s = 1; s < shards.size(); s++)
+            workers.push_back(std::thread{&AgentWalletStore::runSettleWorker, this, s});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{settleMutex};
+        workersBusy = workers.size();
+        settleGeneration++;
+    }
+
+    settleStarted.notify_all();
+    settleShard(0);
+
+    std::unique_lock<std::mutex> lock{settleMutex};
+    settleFinished.wait(lock, [this]() { return workersBusy == 0; });
+}
+
+void AgentWalletStore::settleShard(size_t s)
+{
+    /** each shard only ever touches its own table, so no locking is needed */
+    std::vector<double>& balances = shards[s].balances;
+    size_t currencyCount = currencies.size();
+
+    for (BalanceChange& change : changes[s])
+        balances[change.row * currencyCount + change.currency] += change.amount;
+}
+
+void AgentWalletStore::runSettleWorker(size_t s)
+{
+    uint64_t settledGeneration = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock{settleMutex};
+            settleStarted.wait(lock, [this, settledGeneration]() { return stopping || settleGeneration != settledGeneration; });
+
+            if (stopping)
+                return;
+
+            settledGeneration = settleGeneration;
+        }
+
+        settleShard(s);
+
+        {
+            std::lock_guard<std::mutex> lock{settleMutex};
+            workersBusy--;
+        }
+
+        settleFinished.notify_one();
+    }
+}
+
+void AgentWalletStore::exportBalances(std::vector<std::string>& currencyNames, std::vector<double>& balances)
+{
+    currencyNames = currencies;
+    balances.clear();
+    balances.reserve(agentCount * currencies.size());
+
+    for (uint32_t agentId = 1; agentId <= agentCount; agentId++)
+    {
+        double* row = &getShard(agentId).balances[getRow(agentId) * currencies.size()];
+        balances.insert(balances.end(), row, row + currencies.size());
+    }
+}
+
+void AgentWalletStore::importBalances(std::vector<std::string>& currencyNames, std::vector<double>& balances)
+{
+    for (Shard& shard : shards)
+        shard = Shard{};
+
+    agentCount = 0;
+    currencies.clear();
+    currencyIndex.clear();
+    productCurrencies.clear();
+
+    for (std::string& currency : currencyNames)
+        getCurrencyIndex(currency);
+
+    if (currencies.empty())
+        return;
+
+    std::map<std::string, double> none;
+    addAgents(balances.size() / currencies.size(), none);
+
+    for (uint32_t agentId = 1; agentId <= agentCount; agentId++)
+    {
+        double* row = &getShard(agentId).balances[getRow(agentId) * currencies.size()];
+
+        for (size_t c = 0; c < currencies.size(); c++)
+            row[c] = balances[(agentId - 1) * currencies.size() + c];
+    }
+}
+
+std::string AgentWalletStore::toString()
+{
+    std::string storeStr = "Agents: " + std::to_string(agentCount) + "\n";
+    std::vector<double> totals(currencies.size(), 0);
+
+    for (Shard& shard : shards)
+        for (size_t i = 0; i < shard.balances.size(); i++)
+            totals[i % currencies.size()] += shard.balances[i];
+
+    for (size_t c = 0; c < currencies.size(); c++)
+        storeStr += currencies[c] + ": " + std::to_string(totals[c]) + "\n";
+
+    return storeStr;
+}
+
+unsigned int AgentWalletStore::getCurrencyIndex(const std::string& currency)
+{
+    std::unordered_map<std::string, unsigned int>::iterator column = currencyIndex.find(currency);
+
+    if (column != currencyIndex.end())
+        return column->second;
+
+    unsigned int index = currencies.size();
+    currencies.push_back(currency);
+    currencyIndex[currency] = index;
+
+    /** rebuild every table one column wider */
+    for (Shard& shard : shards)
+    {
+        std::vector<double> widened(shard.agentCount * currencies.size(), 0);
+
+        for (uint32_t row = 0; row < shard.agentCount; row++)
+            for (unsigned int c = 0; c < index; c++)
+                widened[row * currencies.size() + c] = shard.balances[row * index + c];
+
+        shard.balances.swap(widened);
+    }
+
+    return index;
+}
+
+std::pair<unsigned int, unsigned int> AgentWalletStore::getProductCurrencies(const std::string& product)
+{
+    std::unordered_map<std::string, std::pair<unsigned int, unsigned int>>::iterator cached = productCurrencies.find(product);
+
+    if (cached != productCurrencies.end())
+        return cached->second;
+
+    std::vector<std::string> names = CSVReader::tokenise(product, '/');
+
+    if (names.size() != 2)
+        throw std::exception{};
+
+    std::pair<unsigned int, unsigned int> columns{getCurrencyIndex(names[0]), getCurrencyIndex(names[1])};
+    productCurrencies[product] = columns;
+
+    return columns;
+}
+
+AgentWalletStore::Shard& AgentWalletStore::getShard(uint32_t agentId)
+{
+    return shards[(agentId - 1) % shards.size()];
+}
+
+uint32_t AgentWalletStore::getRow(uint32_t agentId)
+{
+    return (agentId - 1) / shards.size();
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+
+#include "../headers/BinaryIO.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <exception>
+
+BinaryWriter::BinaryWriter()
+{
+
+}
+
+void BinaryWriter::writeUInt8(uint8_t value)
+{
+    buffer.push_back(static_cast<char>(value));
+}
+
+void BinaryWriter::writeUInt32(uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+}
+
+void BinaryWriter::writeUInt64(uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+}
+
+void BinaryWriter::writeDouble(double value)
+{
+    /** copy the bits rather than casting, which would convert the value */
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    writeUInt64(bits);
+}
+
+void BinaryWriter::writeVarint(uint64_t value)
+{
+    /** the high bit of each byte says whether another one follows */
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    buffer.push_back(static_cast<char>(value));
+}
+
+void BinaryWriter::writeString(const std::string& value)
+{
+    writeUInt32(value.size());
+    buffer.append(value);
+}
+
+std::string& BinaryWriter::getBuffer()
+{
+    return buffer;
+}
+
+BinaryReader::BinaryReader(const std::string& _buffer)
+:   buffer(_buffer),
+    position(0)
+{
+
+}
+
+std::string BinaryReader::readFile(const std::string& filename)
+{
+    std::ifstream file{filename, std::ios::binary};
+
+    if (file.is_open() == false)
+        throw std::exception{};
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    return contents.str();
+}
+
+uint8_t BinaryReader::readUInt8()
+{
+    require(1);
+    return static_cast<uint8_t>(buffer[position++]);
+}
+
+uint32_t BinaryReader::readUInt32()
+{
+    require(4);
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++)
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(buffer[position++])) << (i * 8);
+
+    return value;
+}
+
+uint64_t BinaryReader::readUInt64()
+{
+    require(8);
+    uint64_t value = 0;
+
+    for (int i = 0; i < 8; i++)
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(buffer[position++])) << (i * 8);
+
+    return value;
+}
+
+double BinaryReader::readDouble()
+{
+    uint64_t bits = readUInt64();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint64_t BinaryReader::readVarint()
+{
+    uint64_t value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        uint8_t byte = readUInt8();
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+
+    /** more than ten bytes can't be a valid 64-bit varint */
+    throw std::exception{};
+}
+
+std::string BinaryReader::readString()
+{
+    uint32_t length = readUInt32();
+    require(length);
+
+    std::string value = buffer.substr(position, length);
+    position += length;
+    return value;
+}
+
+bool BinaryReader::isAtEnd()
+{
+    return position >= buffer.size();
+}
+
+void BinaryReader::require(size_t bytes)
+{
+    if (buffer.size() - position < bytes)
+        throw std::exception{};
+}
@@ -8,7 +8,7 @@ CSVReader::CSVReader()
     /** No need to initialize in the construction */
 }
 
-std::vector<OrderBookEntry> CSVReader::readCSV(std::string csvFilename)
+std::vector<OrderBookEntry> CSVReader::readCSV(const std::string& csvFilename)
 {
     std::vector<OrderBookEntry> entries;
 
@@ -140,4 +140,24 @@ OrderBookEntry CSVReader::stringsToOBE(
     };
 
     return obe;
-}
\ No newline at end of file
+}
+
+uint64_t CSVReader::stringToUnsigned(std::string value)
+{
+    size_t first = value.find_first_not_of(' ');
+    size_t last = value.find_last_not_of(' ');
+
+    if (first == std::string::npos || value[first] < '0' || value[first] > '9')
+        throw std::exception{};
+
+    value = value.substr(first, last - first + 1);
+
+    /** stoull takes a leading '-' and wraps it around, hence the digit check above */
+    size_t consumed = 0;
+    uint64_t result = std::stoull(value, &consumed);
+
+    if (consumed != value.size())
+        throw std::exception{};
+
+    return result;
+}
@@ -0,0 +1,174 @@
+
+#include "../headers/Checkpoint.h"
+#include "../headers/BinaryIO.h"
+#include <fstream>
+#include <cstdio>
+
+/** "MRKC"; see BinaryIO.h for the header every file starts with */
+static const uint32_t CHECKPOINT_MAGIC = 0x434B524D;
+static const uint32_t CHECKPOINT_VERSION = 5;
+
+Checkpoint::Checkpoint()
+{
+
+}
+
+Checkpoint::~Checkpoint()
+{
+    wait();
+}
+
+std::string Checkpoint::serialize(SimulationState& state)
+{
+    BinaryWriter writer;
+
+    writer.writeUInt32(CHECKPOINT_MAGIC);
+    writer.writeUInt32(CHECKPOINT_VERSION);
+
+    writer.writeString(state.currentTime);
+    writer.writeUInt64(state.timeframesProcessed);
+    writer.writeUInt64(state.salesProcessed);
+
+    writer.writeUInt32(state.userOrders.size());
+
+    for (OrderBookEntry& order : state.userOrders)
+    {
+        writer.writeDouble(order.price);
+        writer.writeDouble(order.amount);
+        writer.writeString(order.timestamp);
+        writer.writeString(order.product);
+        writer.writeUInt8(static_cast<uint8_t>(order.orderType));
+        writer.writeString(order.username);
+        writer.writeUInt64(order.orderId);
+        writer.writeUInt8(static_cast<uint8_t>(order.timeInForce));
+        writer.writeUInt64(order.expiresAt);
+        writer.writeUInt32(order.agentId);
+    }
+
+    writer.writeUInt32(state.balances.size());
+
+    for (std::pair<const std::string, double>& balance : state.balances)
+    {
+        writer.writeString(balance.first);
+        writer.writeDouble(balance.second);
+    }
+
+    writer.writeUInt32(state.agentCurrencies.size());
+
+    for (std::string& currency : state.agentCurrencies)
+        writer.writeString(currency);
+
+    writer.writeUInt64(state.agentBalances.size());
+
+    for (double balance : state.agentBalances)
+        writer.writeDouble(balance);
+
+    writer.writeString(state.indicators);
+
+    return writer.getBuffer();
+}
+
+SimulationState Checkpoint::deserialize(const std::string& buffer)
+{
+    BinaryReader reader{buffer};
+    SimulationState state;
+
+    if (reader.readUInt32() != CHECKPOINT_MAGIC || reader.readUInt32() != CHECKPOINT_VERSION)
+        throw std::exception{};
+
+    state.currentTime = reader.readString();
+    state.timeframesProcessed = reader.readUInt64();
+    state.salesProcessed = reader.readUInt64();
+
+    uint32_t orderCount = reader.readUInt32();
+
+    for (uint32_t i = 0; i < orderCount; i++)
+    {
+        double price = reader.readDouble();
+        double amount = reader.readDouble();
+        std::string timestamp = reader.readString();
+        std::string product = reader.readString();
+        uint8_t orderType = reader.readUInt8();
+        std::string username = reader.readString();
+
+        /** only bids and asks rest in the book */
+        if (orderType > static_cast<uint8_t>(OrderBookType::ask))
+            throw std::exception{};
+
+        OrderBookEntry order{price, amount, timestamp, product, static_cast<OrderBookType>(orderType), username};
+        order.orderId = reader.readUInt64();
+        uint8_t timeInForce = reader.readUInt8();
+
+        if (timeInForce > static_cast<uint8_t>(TimeInForce::gtt))
+            throw std::exception{};
+
+        order.timeInForce = static_cast<TimeInForce>(timeInForce);
+        order.expiresAt = reader.readUInt64();
+        order.agentId = reader.readUInt32();
+        state.userOrders.push_back(order);
+    }
+
+    uint32_t balanceCount = reader.readUInt32();
+
+    for (uint32_t i = 0; i < balanceCount; i++)
+    {
+        std::string currency = reader.readString();
+        state.balances[currency] = reader.readDouble();
+    }
+
+    uint32_t agentCurrencyCount = reader.readUInt32();
+
+    for (uint32_t i = 0; i < agentCurrencyCount; i++)
+        state.agentCurrencies.push_back(reader.readString());
+
+    uint64_t agentBalanceCount = reader.readUInt64();
+
+    for (uint64_t i = 0; i < agentBalanceCount; i++)
+        state.agentBalances.push_back(reader.readDouble());
+
+    state.indicators = reader.readString();
+
+    if (reader.isAtEnd() == false)
+        throw std::exception{};
+
+    return state;
+}
+
+void Checkpoint::writeAsync(const std::string& filename, std::string buffer)
+{
+    wait();
+    writer = std::thread{&Checkpoint::writeFile, filename, std::move(buffer)};
+}
+
+void Checkpoint::wait()
+{
+    if (writer.joinable())
+        writer.join();
+}
+
+void Checkpoint::writeFile(const std::string& filename, const std::string& buffer)
+{
+    std::string tempFilename = filename + ".tmp";
+    std::ofstream file{tempFilename, std::ios::binary | std::ios::trunc};
+
+    if (file.is_open() == false)
+    {
+        std::cout << "Checkpoint::writeFile could not open " << tempFilename << std::endl;
+        return;
+    }
+
+    file.write(buffer.data(), buffer.size());
+    bool written = file.good();
+    file.close();
+
+    /** a short write, e.g. on a full disk, must never replace the last good checkpoint */
+    if (written == false || file.good() == false)
+    {
+        std::cout << "Checkpoint::writeFile could not write " << tempFilename << std::endl;
+        std::remove(tempFilename.c_str());
+        return;
+    }
+
+    if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+        std::cout << "Checkpoint::writeFile could not replace " << filename << std::endl;
+}
\ No newline at end of file
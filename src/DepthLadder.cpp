@@ -0,0 +1,146 @@
+
+#include "../headers/DepthLadder.h"
+#include <algorithm>
+#include <functional>
+
+DepthLadder::DepthLadder()
+:   side(OrderBookType::ask)
+{
+
+}
+
+void DepthLadder::build(const OrderView& orders, OrderBookType _side)
+{
+    side = _side;
+    levels.clear();
+
+    /** only the price and amount are needed, so the orders themselves are never copied */
+    std::vector<std::pair<double, double>> quotes;
+
+    for (const OrderBookEntry& order : orders)
+        quotes.push_back(std::make_pair(order.price, order.amount));
+
+    /** best price first: lowest asks and highest bids */
+    if (side == OrderBookType::ask)
+        std::sort(quotes.begin(), quotes.end());
+
+    else std::sort(quotes.begin(), quotes.end(), std::greater<std::pair<double, double>>());
+
+    double cumulativeAmount = 0;
+    double cumulativeNotional = 0;
+
+    for (std::pair<double, double>& quote : quotes)
+    {
+        double price = quote.first;
+        double amount = quote.second;
+
+        cumulativeAmount += amount;
+        cumulativeNotional += amount * price;
+
+        /** orders at the same price collapse into a single level */
+        if (levels.empty() == false && levels.back().price == price)
+        {
+            levels.back().amount += amount;
+            levels.back().cumulativeAmount = cumulativeAmount;
+            levels.back().cumulativeNotional = cumulativeNotional;
+        }
+
+        else levels.push_back(DepthLevel{price, amount, cumulativeAmount, cumulativeNotional});
+    }
+}
+
+double DepthLadder::getVolumeUpTo(double price)
+{
+    unsigned int count = countLevelsUpTo(price);
+
+    if (count == 0)
+        return 0;
+
+    return levels[count - 1].cumulativeAmount;
+}
+
+double DepthLadder::getNotionalUpTo(double price)
+{
+    unsigned int count = countLevelsUpTo(price);
+
+    if (count == 0)
+        return 0;
+
+    return levels[count - 1].cumulativeNotional;
+}
+
+double DepthLadder::getAverageFillPrice(double quantity)
+{
+    if (quantity <= 0 || levels.empty() || quantity > levels.back().cumulativeAmount)
+        return 0;
+
+    /** first level whose running total covers the quantity; everything before it is consumed whole */
+    std::vector<DepthLevel>::iterator level = std::lower_bound(
+        levels.begin(),
+        levels.end(),
+        quantity,
+        [](const DepthLevel& l, double q) { return l.cumulativeAmount < q; }
+    );
+
+    double consumedAmount = 0;
+    double consumedNotional = 0;
+
+    if (level != levels.begin())
+    {
+        consumedAmount = (level - 1)->cumulativeAmount;
+        consumedNotional = (level - 1)->cumulativeNotional;
+    }
+
+    /** the last level is only partially consumed */
+    double notional = consumedNotional + (quantity - consumedAmount) * level->price;
+    return notional / quantity;
+}
+
+std::vector<DepthLevel> DepthLadder::getTopLevels(unsigned int n)
+{
+    if (n > levels.size())
+        n = levels.size();
+
+    return std::vector<DepthLevel>(levels.begin(), levels.begin() + n);
+}
+
+double DepthLadder::getBestPrice()
+{
+    if (levels.empty())
+        return 0;
+
+    return levels[0].price;
+}
+
+double DepthLadder::getTotalAmount()
+{
+    if (levels.empty())
+        return 0;
+
+    return levels.back().cumulativeAmount;
+}
+
+bool DepthLadder::isEmpty()
+{
+    return levels.empty();
+}
+
+bool DepthLadder::isBetterPrice(double price, double than)
+{
+    if (side == OrderBookType::ask)
+        return price < than;
+
+    return price > than;
+}
+
+unsigned int DepthLadder::countLevelsUpTo(double price)
+{
+    /** levels are sorted best first, so the ones within the limit form a prefix */
+    std::vector<DepthLevel>::iterator end = std::partition_point(
+        levels.begin(),
+        levels.end(),
+        [this, price](const DepthLevel& l) { return isBetterPrice(price, l.price) == false; }
+    );
+
+    return end - levels.begin();
+}
\ No newline at end of file
@@ -0,0 +1,251 @@
+
+#include "../headers/EventLog.h"
+#include <cstdio>
+
+/** "MRKE"; see BinaryIO.h for the header every file starts with */
+static const uint32_t EVENT_LOG_MAGIC = 0x454B524D;
+static const uint32_t EVENT_LOG_VERSION = 1;
+
+/** earlier runs' logs kept beside the new one, so a restart doesn't wipe the log of the run that crashed */
+static const unsigned int PREVIOUS_LOGS_KEPT = 3;
+
+EventLogWriter::EventLogWriter()
+:   sequence(0)
+{
+
+}
+
+EventLogWriter::~EventLogWriter()
+{
+    flush();
+}
+
+bool EventLogWriter::open(const std::string& filename)
+{
+    /** shift filename.1 to filename.2 and so on, dropping the oldest; renames of missing files just fail */
+    std::remove((filename + "." + std::to_string(PREVIOUS_LOGS_KEPT)).c_str());
+
+    for (unsigned int i = PREVIOUS_LOGS_KEPT - 1; i >= 1; i--)
+        std::rename((filename + "." + std::to_string(i)).c_str(), (filename + "." + std::to_string(i + 1)).c_str());
+
+    std::rename(filename.c_str(), (filename + ".1").c_str());
+
+    file.open(filename, std::ios::binary | std::ios::trunc);
+
+    if (file.is_open() == false)
+        return false;
+
+    sequence = 0;
+    textIds.clear();
+    buffer.getBuffer().clear();
+
+    buffer.writeUInt32(EVENT_LOG_MAGIC);
+    buffer.writeUInt32(EVENT_LOG_VERSION);
+    flush();
+
+    return true;
+}
+
+bool EventLogWriter::isOpen()
+{
+    return file.is_open();
+}
+
+void EventLogWriter::append(Event& event)
+{
+    if (file.is_open() == false)
+        return;
+
+    event.sequence = ++sequence;
+
+    buffer.writeUInt8(static_cast<uint8_t>(event.type));
+
+    if (event.type == EventType::datasetOrder)
+        writeOrder(event.command.order);
+
+    else if (event.type == EventType::command)
+    {
+        buffer.writeUInt8(static_cast<uint8_t>(event.command.type));
+        writeOrder(event.command.order);
+    }
+
+    else if (event.type == EventType::deposit)
+    {
+        writeText(event.currency);
+        buffer.writeDouble(event.amount);
+    }
+
+    else if (event.type == EventType::spawnAgents)
+    {
+        buffer.writeVarint(event.agentCount);
+        buffer.writeVarint(event.balances.size());
+
+        for (std::pair<const std::string, double>& balance : event.balances)
+        {
+            writeText(balance.first);
+            buffer.writeDouble(balance.second);
+        }
+    }
+
+    else if (event.type == EventType::agentOrders)
+        buffer.writeVarint(event.firstOrderId);
+
+    else if (event.type == EventType::restore)
+        buffer.writeString(event.checkpoint);
+}
+
+void EventLogWriter::flush()
+{
+    if (file.is_open() == false || buffer.getBuffer().empty())
+        return;
+
+    file.write(buffer.getBuffer().data(), buffer.getBuffer().size());
+    file.flush();
+    buffer.getBuffer().clear();
+}
+
+uint64_t EventLogWriter::getSequence()
+{
+    return sequence;
+}
+
+void EventLogWriter::writeOrder(OrderBookEntry& order)
+{
+    /** doubles are written bit for bit so a replay sees exactly the same prices and amounts */
+    buffer.writeDouble(order.price);
+    buffer.writeDouble(order.amount);
+    writeText(order.timestamp);
+    writeText(order.product);
+    buffer.writeUInt8(static_cast<uint8_t>(order.orderType));
+    writeText(order.username);
+    buffer.writeVarint(order.orderId);
+    buffer.writeUInt8(static_cast<uint8_t>(order.timeInForce));
+    buffer.writeVarint(order.expiresAt);
+    buffer.writeVarint(order.agentId);
+}
+
+void EventLogWriter::writeText(const std::string& text)
+{
+    std::unordered_map<std::string, uint32_t>::iterator found = textIds.find(text);
+
+    if (found != textIds.end())
+    {
+        buffer.writeVarint(found->second);
+        return;
+    }
+
+    /** a text's first appearance takes the next id and carries the text itself */
+    uint32_t id = textIds.size();
+    textIds[text] = id;
+
+    buffer.writeVarint(id);
+    buffer.writeString(text);
+}
+
+EventLogReader::EventLogReader(const std::string& filename)
+:   contents(BinaryReader::readFile(filename)),
+    reader(contents)
+{
+    if (reader.readUInt32() != EVENT_LOG_MAGIC || reader.readUInt32() != EVENT_LOG_VERSION)
+        throw std::exception{};
+}
+
+bool EventLogReader::next(Event& event)
+{
+    if (reader.isAtEnd())
+        return false;
+
+    uint64_t sequence = event.sequence + 1;
+    event = Event{};
+    event.sequence = sequence;
+
+    /** enums are range checked before they are cast, so a corrupt byte stops the replay here */
+    uint8_t type = reader.readUInt8();
+
+    if (type < static_cast<uint8_t>(EventType::datasetOrder) || type > static_cast<uint8_t>(EventType::restore))
+        throw std::exception{};
+
+    event.type = static_cast<EventType>(type);
+
+    if (event.type == EventType::datasetOrder)
+        event.command.order = readOrder();
+
+    else if (event.type == EventType::command)
+    {
+        uint8_t commandType = reader.readUInt8();
+
+        if (commandType > static_cast<uint8_t>(OrderCommandType::amend))
+            throw std::exception{};
+
+        event.command.type = static_cast<OrderCommandType>(commandType);
+        event.command.order = readOrder();
+    }
+
+    else if (event.type == EventType::deposit)
+    {
+        event.currency = readText();
+        event.amount = reader.readDouble();
+    }
+
+    else if (event.type == EventType::spawnAgents)
+    {
+        event.agentCount = reader.readVarint();
+        uint64_t balanceCount = reader.readVarint();
+
+        for (uint64_t i = 0; i < balanceCount; i++)
+        {
+            std::string currency = readText();
+            event.balances[currency] = reader.readDouble();
+        }
+    }
+
+    else if (event.type == EventType::agentOrders)
+        event.firstOrderId = reader.readVarint();
+
+    else if (event.type == EventType::restore)
+        event.checkpoint = reader.readString();
+
+    return true;
+}
+
+OrderBookEntry EventLogReader::readOrder()
+{
+    double price = reader.readDouble();
+    double amount = reader.readDouble();
+    std::string timestamp = readText();
+    std::string product = readText();
+    uint8_t orderType = reader.readUInt8();
+    std::string username = readText();
+
+    /** cancels and amends leave the side unknown, so unknown is allowed along with the real sides */
+    if (orderType > static_cast<uint8_t>(OrderBookType::unknown))
+        throw std::exception{};
+
+    OrderBookEntry order{price, amount, timestamp, product, static_cast<OrderBookType>(orderType), username};
+    order.orderId = reader.readVarint();
+    uint8_t timeInForce = reader.readUInt8();
+
+    if (timeInForce > static_cast<uint8_t>(TimeInForce::gtt))
+        throw std::exception{};
+
+    order.timeInForce = static_cast<TimeInForce>(timeInForce);
+    order.expiresAt = reader.readVarint();
+    order.agentId = reader.readVarint();
+
+    return order;
+}
+
+std::string EventLogReader::readText()
+{
+    uint64_t id = reader.readVarint();
+
+    if (id < texts.size())
+        return texts[id];
+
+    /** ids are handed out in order, so an unseen one must be the next */
+    if (id != texts.size())
+        throw std::exception{};
+
+    texts.push_back(reader.readString());
+    return texts.back();
+}
\ No newline at end of file
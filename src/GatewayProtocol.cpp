@@ -0,0 +1,167 @@
+
+#include "../headers/GatewayProtocol.h"
+#include "../headers/BinaryIO.h"
+#include <exception>
+
+std::string GatewayProtocol::encode(GatewayMessage& message)
+{
+    BinaryWriter writer;
+
+    /** leave room for the length, filled in once the payload is written */
+    writer.writeUInt32(0);
+    writer.writeUInt8(static_cast<uint8_t>(message.type));
+    writer.writeUInt32(message.requestId);
+
+    switch (message.type)
+    {
+        case GatewayMessageType::submit:
+            writer.writeUInt8(message.side);
+            writer.writeDouble(message.price);
+            writer.writeDouble(message.amount);
+            writer.writeString(message.product);
+            writer.writeUInt8(message.timeInForce);
+            writer.writeUInt32(message.expiresAfter);
+            break;
+
+        case GatewayMessageType::cancel:
+            writer.writeUInt64(message.orderId);
+            break;
+
+        case GatewayMessageType::amend:
+            writer.writeUInt64(message.orderId);
+            writer.writeDouble(message.price);
+            writer.writeDouble(message.amount);
+            break;
+
+        case GatewayMessageType::subscribe:
+            writer.writeString(message.product);
+            break;
+
+        case GatewayMessageType::walletQuery:
+            break;
+
+        case GatewayMessageType::ack:
+            writer.writeUInt8(static_cast<uint8_t>(message.status));
+            writer.writeUInt64(message.orderId);
+            break;
+
+        case GatewayMessageType::marketData:
+            writer.writeString(message.product);
+            writer.writeString(message.timestamp);
+            writer.writeDouble(message.bestBid);
+            writer.writeDouble(message.bidDepth);
+            writer.writeDouble(message.bestAsk);
+            writer.writeDouble(message.askDepth);
+            break;
+
+        case GatewayMessageType::walletReport:
+            writer.writeUInt32(message.balances.size());
+
+            for (std::pair<const std::string, double>& balance : message.balances)
+            {
+                writer.writeString(balance.first);
+                writer.writeDouble(balance.second);
+            }
+
+            break;
+    }
+
+    std::string& frame = writer.getBuffer();
+    uint32_t length = frame.size() - 4;
+
+    for (int i = 0; i < 4; i++)
+        frame[i] = static_cast<char>((length >> (i * 8)) & 0xFF);
+
+    return frame;
+}
+
+GatewayMessage GatewayProtocol::decode(const std::string& payload)
+{
+    BinaryReader reader{payload};
+    GatewayMessage message;
+
+    message.type = static_cast<GatewayMessageType>(reader.readUInt8());
+    message.requestId = reader.readUInt32();
+
+    switch (message.type)
+    {
+        case GatewayMessageType::submit:
+            message.side = reader.readUInt8();
+            message.price = reader.readDouble();
+            message.amount = reader.readDouble();
+            message.product = reader.readString();
+            message.timeInForce = reader.readUInt8();
+            message.expiresAfter = reader.readUInt32();
+            break;
+
+        case GatewayMessageType::cancel:
+            message.orderId = reader.readUInt64();
+            break;
+
+        case GatewayMessageType::amend:
+            message.orderId = reader.readUInt64();
+            message.price = reader.readDouble();
+            message.amount = reader.readDouble();
+            break;
+
+        case GatewayMessageType::subscribe:
+            message.product = reader.readString();
+            break;
+
+        case GatewayMessageType::walletQuery:
+            break;
+
+        case GatewayMessageType::ack:
+            message.status = static_cast<GatewayStatus>(reader.readUInt8());
+            message.orderId = reader.readUInt64();
+            break;
+
+        case GatewayMessageType::marketData:
+            message.product = reader.readString();
+            message.timestamp = reader.readString();
+            message.bestBid = reader.readDouble();
+            message.bidDepth = reader.readDouble();
+            message.bestAsk = reader.readDouble();
+            message.askDepth = reader.readDouble();
+            break;
+
+        case GatewayMessageType::walletReport:
+        {
+            uint32_t count = reader.readUInt32();
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                std::string currency = reader.readString();
+                message.balances[currency] = reader.readDouble();
+            }
+
+            break;
+        }
+
+        default:
+            throw std::exception{};
+    }
+
+    return message;
+}
+
+bool GatewayProtocol::extractFrame(const std::string& input, size_t& offset, std::string& payload)
+{
+    if (input.size() - offset < 4)
+        return false;
+
+    uint32_t length = 0;
+
+    for (int i = 0; i < 4; i++)
+        length |= static_cast<uint32_t>(static_cast<uint8_t>(input[offset + i])) << (i * 8);
+
+    if (length > maxFrameSize)
+        throw std::exception{};
+
+    if (input.size() - offset - 4 < length)
+        return false;
+
+    payload.assign(input, offset + 4, length);
+    offset += 4 + length;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,184 @@
+
+#include "../headers/IndicatorEngine.h"
+#include <cmath>
+#include <algorithm>
+
+IndicatorEngine::IndicatorEngine()
+{
+
+}
+
+void IndicatorEngine::addWindow(unsigned int length)
+{
+    if (length == 0)
+        return;
+
+    windowLengths.push_back(length);
+
+    /** products already being tracked start the new window from scratch */
+    for (std::pair<const std::string, ProductState>& product : products)
+        product.second = createProductState();
+}
+
+std::vector<unsigned int> IndicatorEngine::getWindows()
+{
+    return windowLengths;
+}
+
+void IndicatorEngine::update(const std::string& product, double price, double bidVolume, double askVolume)
+{
+    std::unordered_map<std::string, ProductState>::iterator found = products.find(product);
+
+    /** a timeframe with an empty book still counts: the last price is carried over with no
+     *  volume, so a window of n always spans n timeframes rather than n quoted ones */
+    if (price <= 0)
+    {
+        if (found == products.end())
+            return;
+
+        price = found->second.lastPrice;
+        bidVolume = 0;
+        askVolume = 0;
+    }
+
+    if (found == products.end())
+        found = products.insert(std::make_pair(product, createProductState())).first;
+
+    ProductState& state = found->second;
+
+    /** the very first timeframe has nothing to compare against */
+    bool hasReturn = state.lastPrice > 0 && price > 0;
+    double priceReturn = hasReturn ? price / state.lastPrice - 1 : 0;
+
+    for (size_t i = 0; i < windowLengths.size(); i++)
+    {
+        WindowState& window = state.windows[i];
+
+        window.prices.push(price);
+        window.bidVolumes.push(bidVolume);
+        window.askVolumes.push(askVolume);
+
+        if (hasReturn)
+            window.returns.push(priceReturn);
+
+        /** seed the exponential average with the first price rather than with zero */
+        double alpha = 2.0 / (windowLengths[i] + 1);
+
+        if (window.prices.getCount() == 1)
+            window.exponentialAverage = price;
+
+        else window.exponentialAverage += alpha * (price - window.exponentialAverage);
+    }
+
+    state.lastPrice = price;
+}
+
+IndicatorValues IndicatorEngine::getValues(const std::string& product, unsigned int window)
+{
+    IndicatorValues values;
+    std::unordered_map<std::string, ProductState>::iterator found = products.find(product);
+
+    if (found == products.end())
+        return values;
+
+    for (size_t i = 0; i < windowLengths.size(); i++)
+    {
+        if (windowLengths[i] != window)
+            continue;
+
+        WindowState& state = found->second.windows[i];
+        double volume = state.bidVolumes.getSum() + state.askVolumes.getSum();
+
+        values.movingAverage = state.prices.getMean();
+        values.exponentialAverage = state.exponentialAverage;
+        values.volatility = std::sqrt(state.returns.getVariance());
+        values.imbalance = volume > 0 ? (state.bidVolumes.getSum() - state.askVolumes.getSum()) / volume : 0;
+        values.ready = state.prices.isFull();
+        break;
+    }
+
+    return values;
+}
+
+void IndicatorEngine::save(BinaryWriter& writer)
+{
+    writer.writeUInt32(windowLengths.size());
+
+    for (unsigned int length : windowLengths)
+        writer.writeUInt32(length);
+
+    /** written in name order, so the bytes depend only on the state and not on how the hash map lays it out */
+    std::vector<std::string> names;
+
+    for (std::pair<const std::string, ProductState>& product : products)
+        names.push_back(product.first);
+
+    std::sort(names.begin(), names.end());
+
+    writer.writeUInt32(names.size());
+
+    for (std::string& name : names)
+    {
+        ProductState& product = products[name];
+        writer.writeString(name);
+        writer.writeDouble(product.lastPrice);
+
+        for (WindowState& window : product.windows)
+        {
+            window.prices.save(writer);
+            window.returns.save(writer);
+            window.bidVolumes.save(writer);
+            window.askVolumes.save(writer);
+            writer.writeDouble(window.exponentialAverage);
+        }
+    }
+}
+
+void IndicatorEngine::load(BinaryReader& reader)
+{
+    windowLengths.clear();
+    products.clear();
+
+    uint32_t windowCount = reader.readUInt32();
+
+    for (uint32_t i = 0; i < windowCount; i++)
+        windowLengths.push_back(reader.readUInt32());
+
+    uint32_t productCount = reader.readUInt32();
+
+    for (uint32_t i = 0; i < productCount; i++)
+    {
+        std::string product = reader.readString();
+        ProductState state = createProductState();
+        state.lastPrice = reader.readDouble();
+
+        for (WindowState& window : state.windows)
+        {
+            window.prices.load(reader);
+            window.returns.load(reader);
+            window.bidVolumes.load(reader);
+            window.askVolumes.load(reader);
+            window.exponentialAverage = reader.readDouble();
+        }
+
+        products[product] = state;
+    }
+}
+
+IndicatorEngine::ProductState IndicatorEngine::createProductState()
+{
+    ProductState state;
+
+    for (unsigned int length : windowLengths)
+    {
+        state.windows.push_back(WindowState{
+            RollingWindow{length},
+            RollingWindow{length},
+            RollingWindow{length},
+            RollingWindow{length},
+            0
+        });
+    }
+
+    return state;
+}
\ No newline at end of file
@@ -1,12 +1,17 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <chrono>
 #include "../headers/MerkelMain.h"
 #include "../headers/CSVReader.h"
 
-MerkelMain::MerkelMain()
+MerkelMain::MerkelMain(bool loadDataset)
+:   orderBook{loadDataset ? datasetFilename : std::string{}}
 {
-
+    indicators.addWindow(5);
+    indicators.addWindow(20);
+    indicators.addWindow(100);
 }
 
 void MerkelMain::init()
@@ -14,7 +19,23 @@ void MerkelMain::init()
     int input;
     currentTime = orderBook.getEarliestTime();
 
-    wallet.insertCurrency("BTC", 10);
+    /** the log starts with the dataset, so a replay needs nothing but the log */
+    if (eventLog.open(eventLogFilename))
+    {
+        for (const OrderBookEntry& order : orderBook.viewDatasetOrders())
+        {
+            Event event;
+            event.type = EventType::datasetOrder;
+            event.command.order = order;
+            eventLog.append(event);
+        }
+
+        eventLog.flush();
+    }
+
+    else std::cout << "MerkelMain::init could not create " << eventLogFilename << std::endl;
+
+    deposit("BTC", 10);
 
     while(true)
     {
@@ -40,10 +61,26 @@ void MerkelMain::printMenu()
 
     std::cout << "7: Exit" << std::endl;
 
+    std::cout << "8: Restore checkpoint" << std::endl;
+
+    std::cout << "9: Cancel an order" << std::endl;
+
+    std::cout << "10: Start order gateway" << std::endl;
+
+    std::cout << "11: Spawn simulated agents" << std::endl;
+
+    std::cout << "12: Archive the order book" << std::endl;
+
+    std::cout << "13: Query the archive" << std::endl;
+
+    std::cout << "14: Query order history" << std::endl;
+
+    std::cout << "15: Print state digest" << std::endl;
+
     std::cout << "=========================" << std::endl;
     std::cout << "Current time is: " << currentTime << std::endl;
 
-    std::cout << "Type in 1-7" << std::endl;
+    std::cout << "Type in 1-15" << std::endl;
 }
 
 int MerkelMain::getUserOption()
@@ -77,24 +114,47 @@ void MerkelMain::printMarketStats()
     for (std::string const& product : orderBook.getKnownProducts())
     {
         std::cout << "Product: " << product << std::endl;
-        std::vector<OrderBookEntry> entries = orderBook.getOrders(OrderBookType::ask, product, currentTime);
+        OrderView asks = orderBook.viewOrders(OrderBookType::ask, product, currentTime);
+
+        std::cout << "Asks seen: " << asks.count() << std::endl;
+        std::cout << "Max ask: " << OrderBook::getHighPrice(asks) << std::endl;
+        std::cout << "Min ask: " << OrderBook::getLowPrice(asks) << std::endl;
+
+        DepthLadder& askLadder = orderBook.getLadder(OrderBookType::ask, product, currentTime);
+        DepthLadder& bidLadder = orderBook.getLadder(OrderBookType::bid, product, currentTime);
+
+        std::cout << "Ask depth: " << askLadder.getTotalAmount() << " Bid depth: " << bidLadder.getTotalAmount() << std::endl;
+
+        for (DepthLevel const& level : askLadder.getTopLevels(5))
+            std::cout << "  ask " << level.price << " x " << level.amount << " (cumulative " << level.cumulativeAmount << ")" << std::endl;
+
+        for (DepthLevel const& level : bidLadder.getTopLevels(5))
+            std::cout << "  bid " << level.price << " x " << level.amount << " (cumulative " << level.cumulativeAmount << ")" << std::endl;
+
+        for (unsigned int window : indicators.getWindows())
+        {
+            IndicatorValues values = indicators.getValues(product, window);
 
-        std::cout << "Asks seen: " << entries.size() << std::endl;
-        std::cout << "Max ask: " << OrderBook::getHighPrice(entries) << std::endl;
-        std::cout << "Min ask: " << OrderBook::getLowPrice(entries) << std::endl;
+            std::cout << "  last " << window << " timeframes" << (values.ready ? "" : " (warming up)") << ":"
+                      << " SMA " << values.movingAverage
+                      << " EMA " << values.exponentialAverage
+                      << " volatility " << values.volatility
+                      << " imbalance " << values.imbalance << std::endl;
+        }
     }
 }
 
 void MerkelMain::enterAsk()
 {
     std::cout << "Make an ask - enter the amount: product, price, amount, e.g. ETH/BTC, 200, 0.5" << std::endl;
+    std::cout << "Optionally add GTC, IOC, FOK or GTT and a number of timeframes, e.g. ETH/BTC, 200, 0.5, GTT, 10" << std::endl;
     std::string input;
 
     std::getline(std::cin, input);
 
     std::vector<std::string> tokens = CSVReader::tokenise(input, ',');
 
-    if (tokens.size() != 3)
+    if (tokens.size() < 3 || tokens.size() > 5)
         std::cout << "MerkelMain::enterAsk Bad input! " << input << std::endl;
 
     else
@@ -110,11 +170,16 @@ void MerkelMain::enterAsk()
             );
 
             obe.username = "simuser";
+            readTimeInForce(tokens, obe);
+
+            /** let the user know how much of the order can be filled straight away */
+            DepthLadder& ladder = orderBook.getLadder(OrderBookType::bid, obe.product, currentTime);
+            std::cout << "Fillable at your price or better: " << ladder.getVolumeUpTo(obe.price) << std::endl;
 
             if (wallet.canFulfillOrder(obe))
             {
                 std::cout << "Wallet looks good. " << std::endl;
-                orderBook.insertOrder(obe);
+                submitOrder(obe);
             }
 
             else std::cout << "Insufficient funds. " << std::endl;
@@ -130,13 +195,14 @@ void MerkelMain::enterAsk()
 void MerkelMain::enterBid()
 {
     std::cout << "Make a bid - enter the amount: product, price, amount, e.g. ETH/BTC, 200, 0.5" << std::endl;
+    std::cout << "Optionally add GTC, IOC, FOK or GTT and a number of timeframes, e.g. ETH/BTC, 200, 0.5, GTT, 10" << std::endl;
     std::string input;
 
     std::getline(std::cin, input);
 
     std::vector<std::string> tokens = CSVReader::tokenise(input, ',');
 
-    if (tokens.size() != 3)
+    if (tokens.size() < 3 || tokens.size() > 5)
         std::cout << "MerkelMain::enterBid Bad input! " << input << std::endl;
 
     else
@@ -152,11 +218,16 @@ void MerkelMain::enterBid()
             );
 
             obe.username = "simuser";
+            readTimeInForce(tokens, obe);
+
+            /** let the user know how much of the order can be filled straight away */
+            DepthLadder& ladder = orderBook.getLadder(OrderBookType::ask, obe.product, currentTime);
+            std::cout << "Fillable at your price or better: " << ladder.getVolumeUpTo(obe.price) << std::endl;
 
             if (wallet.canFulfillOrder(obe))
             {
                 std::cout << "Wallet looks good. " << std::endl;
-                orderBook.insertOrder(obe);
+                submitOrder(obe);
             }
 
             else std::cout << "Insufficient funds. " << std::endl;
@@ -169,39 +240,741 @@ void MerkelMain::enterBid()
     }
 }
 
+void MerkelMain::readTimeInForce(std::vector<std::string>& tokens, OrderBookEntry& obe)
+{
+    if (tokens.size() < 4)
+        return;
+
+    std::string timeInForce = tokens[3];
+    timeInForce.erase(std::remove(timeInForce.begin(), timeInForce.end(), ' '), timeInForce.end());
+
+    obe.timeInForce = OrderBookEntry::stringToTimeInForce(timeInForce);
+
+    /** good-till-time needs a lifetime, and nothing else takes one */
+    if ((obe.timeInForce == TimeInForce::gtt) != (tokens.size() == 5))
+        throw std::exception{};
+
+    /** relative for now; made absolute when the order is taken off the queue */
+    if (obe.timeInForce == TimeInForce::gtt)
+        obe.expiresAt = CSVReader::stringToUnsigned(tokens[4]);
+}
+
 void MerkelMain::printWallet()
 {
     std::cout << wallet.toString() << std::endl;
+
+    if (agentWallets.getAgentCount() > 0)
+        std::cout << agentWallets.toString() << std::endl;
+}
+
+void MerkelMain::enterCancel()
+{
+    std::cout << "Cancel an order - enter the order id" << std::endl;
+    std::string input;
+
+    std::getline(std::cin, input);
+
+    try
+    {
+        OrderBookEntry obe{0, 0, currentTime, "", OrderBookType::unknown, "simuser"};
+        obe.orderId = CSVReader::stringToUnsigned(input);
+
+        if (orderQueue.tryPush(OrderCommand{OrderCommandType::cancel, obe}))
+            std::cout << "Cancel queued for order " << obe.orderId << std::endl;
+
+        else std::cout << "Order queue is full, try again after the next timeframe." << std::endl;
+    }
+
+    catch(const std::exception& e)
+    {
+        std::cout << "MerkelMain::enterCancel Bad input! " << input << std::endl;
+    }
+}
+
+bool MerkelMain::submitOrder(OrderBookEntry& order)
+{
+    order.orderId = orderBook.allocateOrderId();
+
+    if (orderQueue.tryPush(OrderCommand{OrderCommandType::submit, order}) == false)
+    {
+        std::cout << "Order queue is full, try again after the next timeframe." << std::endl;
+        return false;
+    }
+
+    std::cout << "Order " << order.orderId << " queued." << std::endl;
+    return true;
+}
+
+void MerkelMain::processOrderQueue()
+{
+    std::vector<OrderCommand> commands;
+    std::vector<OrderBookEntry> accepted;
+
+    /** only take what is already waiting, so busy producers can't keep the boundary open forever */
+    size_t pending = orderQueue.getDepth();
+    size_t applied = 0;
+
+    while (applied < pending)
+    {
+        commands.clear();
+
+        if (orderQueue.drain(commands, orderBatchSize) == 0)
+            break;
+
+        /** logged as drained, so a replay can queue the batch again, and on disk before any of it is applied */
+        for (OrderCommand& command : commands)
+        {
+            Event event;
+            event.type = EventType::command;
+            event.command = command;
+            eventLog.append(event);
+        }
+
+        eventLog.flush();
+
+        for (OrderCommand& command : commands)
+        {
+            OrderBookEntry& order = command.order;
+
+            /** gateway orders don't know the time; they belong to the timeframe they are drained in */
+            if (order.timestamp.empty())
+                order.timestamp = currentTime;
+
+            /** funds are checked here rather than by the producer, since only this thread touches the wallet */
+            if (command.type == OrderCommandType::submit)
+            {
+                if (order.timeInForce == TimeInForce::gtt)
+                    order.expiresAt += timeframesProcessed;
+
+                if (Wallet::hasValidQuantities(order.price, order.amount) == false)
+                    std::cout << "Order " << order.orderId << " rejected: invalid price or amount." << std::endl;
+
+                /** reserving checks the funds too, and holds them until the order leaves the book */
+                else if (wallet.reserveOrder(order))
+                    accepted.push_back(order);
+
+                else std::cout << "Order " << order.orderId << " rejected: insufficient funds." << std::endl;
+            }
+
+            /** cancels and amends may refer to submits from this same batch, so insert those first */
+            else if (command.type == OrderCommandType::cancel)
+            {
+                flushSubmits(accepted);
+
+                if (orderBook.cancelOrder(order.orderId))
+                    wallet.releaseOrder(order.orderId);
+
+                else std::cout << "Order " << order.orderId << " not found." << std::endl;
+            }
+
+            else if (command.type == OrderCommandType::amend)
+            {
+                flushSubmits(accepted);
+                OrderBookEntry* existing = orderBook.findUserOrder(order.orderId);
+
+                if (existing == nullptr)
+                    std::cout << "Order " << order.orderId << " not found." << std::endl;
+
+                else if (Wallet::hasValidQuantities(order.price, order.amount) == false)
+                    std::cout << "Order " << order.orderId << " amend rejected: invalid price or amount." << std::endl;
+
+                else
+                {
+                    OrderBookEntry original = *existing;
+                    OrderBookEntry amended = original;
+                    amended.price = order.price;
+                    amended.amount = order.amount;
+
+                    /** the order's own reservation counts towards what the amended one can use */
+                    wallet.releaseOrder(order.orderId);
+
+                    if (wallet.reserveOrder(amended))
+                        orderBook.amendOrder(order.orderId, order.price, order.amount);
+
+                    else
+                    {
+                        wallet.reserveOrder(original);
+                        std::cout << "Order " << order.orderId << " amend rejected: insufficient funds." << std::endl;
+                    }
+                }
+            }
+        }
+
+        applied += commands.size();
+    }
+
+    flushSubmits(accepted);
+
+    std::cout << "Order queue: applied " << applied
+              << ", waiting " << orderQueue.getDepth()
+              << ", high watermark " << orderQueue.getHighWatermark()
+              << ", turned away " << orderQueue.getRejectedCount() << std::endl;
+}
+
+void MerkelMain::flushSubmits(std::vector<OrderBookEntry>& accepted)
+{
+    if (accepted.empty())
+        return;
+
+    orderBook.insertOrders(accepted);
+    accepted.clear();
+}
+
+void MerkelMain::spawnAgents()
+{
+    std::cout << "Spawn agents - enter how many, and how much of every currency each starts with, e.g. 1000, 10" << std::endl;
+    std::string input;
+
+    std::getline(std::cin, input);
+
+    std::vector<std::string> tokens = CSVReader::tokenise(input, ',');
+
+    if (tokens.size() != 2)
+    {
+        std::cout << "MerkelMain::spawnAgents Bad input! " << input << std::endl;
+        return;
+    }
+
+    try
+    {
+        uint32_t count = std::stoul(tokens[0]);
+        double funding = std::stod(tokens[1]);
+        std::map<std::string, double> balances;
+
+        for (const std::string& product : orderBook.getKnownProducts())
+            for (std::string& currency : CSVReader::tokenise(product, '/'))
+                balances[currency] = funding;
+
+        addAgents(count, balances);
+    }
+
+    catch(const std::exception& e)
+    {
+        std::cout << "MerkelMain::spawnAgents Bad input! " << input << std::endl;
+    }
+}
+
+void MerkelMain::writeArchive()
+{
+    try
+    {
+        uint64_t size = orderBook.writeArchive(archiveFilename);
+        std::cout << "Archived the order book to " << archiveFilename << " (" << size << " bytes)" << std::endl;
+    }
+
+    catch(const std::exception& e)
+    {
+        std::cout << "MerkelMain::writeArchive could not write " << archiveFilename << std::endl;
+    }
+}
+
+void MerkelMain::queryArchive()
+{
+    std::cout << "Query the archive - enter product (or *), start time, end time and optionally min and max price, "
+              << "e.g. ETH/BTC,2020/03/17 17:01:00,2020/03/17 17:02:00,0.02,0.03" << std::endl;
+    std::string input;
+
+    std::getline(std::cin, input);
+
+    std::vector<std::string> tokens = CSVReader::tokenise(input, ',');
+
+    if (tokens.size() != 3 && tokens.size() != 5)
+    {
+        std::cout << "MerkelMain::queryArchive Bad input! " << input << std::endl;
+        return;
+    }
+
+    try
+    {
+        ArchiveQuery query;
+        query.product = tokens[0] == "*" ? "" : tokens[0];
+        query.startTime = tokens[1];
+        query.endTime = tokens[2];
+
+        if (tokens.size() == 5)
+        {
+            query.minPrice = std::stod(tokens[3]);
+            query.maxPrice = std::stod(tokens[4]);
+        }
+
+        ArchiveScanStats stats;
+        std::vector<OrderBookEntry> results = OrderBook::queryArchive(archiveFilename, query, stats);
+
+        for (size_t i = 0; i < results.size() && i < 10; i++)
+        {
+            OrderBookEntry& entry = results[i];
+            std::cout << entry.timestamp << " " << entry.product << " "
+                      << (entry.orderType == OrderBookType::ask ? "ask" : "bid") << " "
+                      << entry.price << " x " << entry.amount << std::endl;
+        }
+
+        std::cout << "Found " << results.size() << " orders, reading " << stats.chunksRead << " of " << stats.chunksTotal
+                  << " chunks (" << stats.bytesRead << " bytes)" << std::endl;
+    }
+
+    catch(const std::exception& e)
+    {
+        std::cout << "MerkelMain::queryArchive could not query " << archiveFilename << " with " << input << std::endl;
+    }
+}
+
+void MerkelMain::queryOrders()
+{
+    std::cout << "Query order history - enter product, side, owner, start time, end time, min price and max price, "
+              << "using * for any, e.g. ETH/BTC,bid,*,2020/03/17 17:00:00,2020/03/17 17:30:00,0.0218,0.0220" << std::endl;
+    std::string input;
+
+    std::getline(std::cin, input);
+
+    std::vector<std::string> tokens = CSVReader::tokenise(input, ',');
+
+    if (tokens.size() != 7)
+    {
+        std::cout << "MerkelMain::queryOrders Bad input! " << input << std::endl;
+        return;
+    }
+
+    try
+    {
+        OrderQuery query;
+        query.product = tokens[0] == "*" ? "" : tokens[0];
+        query.owner = tokens[2] == "*" ? "" : tokens[2];
+        query.startTime = tokens[3] == "*" ? "" : tokens[3];
+        query.endTime = tokens[4] == "*" ? "" : tokens[4];
+        query.minPrice = tokens[5] == "*" ? 0 : std::stod(tokens[5]);
+        query.maxPrice = tokens[6] == "*" ? 0 : std::stod(tokens[6]);
+        query.rowLimit = 10;
+
+        if (tokens[1] != "*")
+        {
+            query.type = OrderBookEntry::stringToOrderBookType(tokens[1]);
+
+            if (query.type == OrderBookType::unknown)
+                throw std::exception{};
+        }
+
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        OrderQueryResult result = orderBook.queryOrders(query);
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+        for (OrderBookEntry& entry : result.rows)
+        {
+            std::cout << entry.timestamp << " " << entry.product << " "
+                      << (entry.orderType == OrderBookType::ask ? "ask" : "bid") << " "
+                      << entry.price << " x " << entry.amount << " " << entry.username << std::endl;
+        }
+
+        std::cout << "Matched " << result.count << " orders in " << elapsed << "ms" << std::endl;
+
+        if (result.count > 0)
+        {
+            std::cout << "Total amount: " << result.totalAmount << " Total value: " << result.totalNotional << std::endl;
+            std::cout << "Min price: " << result.minPrice << " Max price: " << result.maxPrice << std::endl;
+        }
+    }
+
+    catch(const std::exception& e)
+    {
+        std::cout << "MerkelMain::queryOrders Bad input! " << input << std::endl;
+    }
+}
+
+void MerkelMain::addAgents(uint32_t count, std::map<std::string, double>& balances)
+{
+    Event event;
+    event.type = EventType::spawnAgents;
+    event.agentCount = count;
+    event.balances = balances;
+    eventLog.append(event);
+    eventLog.flush();
+
+    uint32_t firstId = agentWallets.addAgents(count, balances);
+    std::cout << "Spawned agents " << firstId << " to " << agentWallets.getAgentCount() << std::endl;
+}
+
+void MerkelMain::deposit(const std::string& currency, double amount)
+{
+    Event event;
+    event.type = EventType::deposit;
+    event.currency = currency;
+    event.amount = amount;
+    eventLog.append(event);
+    eventLog.flush();
+
+    wallet.insertCurrency(currency, amount);
+}
+
+void MerkelMain::generateAgentOrders()
+{
+    const std::vector<std::string>& products = orderBook.getKnownProducts();
+    std::vector<OrderBookEntry> batch;
+
+    /** nothing to trade yet, e.g. agents spawned before any dataset was loaded */
+    if (products.empty())
+        return;
+
+    /** the agents take one block of ids, so gateway producers taking ids at the same time
+     *  can't change which ids the agents get, and a replay can hand out the same ones */
+    uint64_t firstOrderId = orderBook.allocateOrderId(agentWallets.getAgentCount());
+
+    Event event;
+    event.type = EventType::agentOrders;
+    event.firstOrderId = firstOrderId;
+    eventLog.append(event);
+    eventLog.flush();
+
+    for (uint32_t agentId = 1; agentId <= agentWallets.getAgentCount(); agentId++)
+    {
+        /** spread the crowd over every product and both sides, rotating each timeframe */
+        uint64_t turn = agentId + timeframesProcessed;
+        const std::string& product = products[turn % products.size()];
+        bool buying = (turn / products.size()) % 2 == 0;
+
+        /** cross the spread: buyers take the best ask and sellers the best bid */
+        OrderBookType opposite = buying ? OrderBookType::ask : OrderBookType::bid;
+        double price = orderBook.getLadder(opposite, product, currentTime).getBestPrice();
+
+        if (price <= 0)
+            continue;
+
+        std::vector<std::string> currencies = CSVReader::tokenise(product, '/');
+        double amount = buying
+            ? agentWallets.getBalance(agentId, currencies[1]) * agentTradeFraction / price
+            : agentWallets.getBalance(agentId, currencies[0]) * agentTradeFraction;
+
+        if (amount <= 0)
+            continue;
+
+        OrderBookEntry order{price, amount, currentTime, product, buying ? OrderBookType::bid : OrderBookType::ask, "agent"};
+        order.orderId = firstOrderId + agentId - 1;
+        order.agentId = agentId;
+        order.timeInForce = TimeInForce::ioc;
+
+        /** nothing is reserved: each agent has a single immediate-or-cancel order, which is settled
+         *  or dropped in this same timeframe, so its balance only has to cover that one order */
+        if (agentWallets.canFulfillOrder(order) == false)
+            continue;
+
+        batch.push_back(order);
+    }
+
+    /** agents run on the matching thread, so they can skip the queue and go in as one batch */
+    orderBook.insertOrders(batch);
+}
+
+void MerkelMain::updateIndicators(const std::string& product)
+{
+    DepthLadder& bids = orderBook.getLadder(OrderBookType::bid, product, currentTime);
+    DepthLadder& asks = orderBook.getLadder(OrderBookType::ask, product, currentTime);
+
+    /** use the mid price, or whichever side is there if the other is empty */
+    double price = bids.getBestPrice();
+
+    if (price == 0)
+        price = asks.getBestPrice();
+
+    else if (asks.isEmpty() == false)
+        price = (price + asks.getBestPrice()) / 2;
+
+    /** an empty book still goes in, so the windows keep counting timeframes */
+    indicators.update(product, price, bids.getTotalAmount(), asks.getTotalAmount());
+}
+
+void MerkelMain::startGateway()
+{
+    if (gateway.start(gatewaySocketPath))
+        publishToGateway();
+}
+
+void MerkelMain::publishToGateway()
+{
+    if (gateway.isRunning() == false)
+        return;
+
+    gateway.publishWallet(wallet.getBalances());
+
+    for (const std::string& product : orderBook.getKnownProducts())
+    {
+        DepthLadder& bids = orderBook.getLadder(OrderBookType::bid, product, currentTime);
+        DepthLadder& asks = orderBook.getLadder(OrderBookType::ask, product, currentTime);
+
+        GatewayMessage update;
+        update.type = GatewayMessageType::marketData;
+        update.product = product;
+        update.timestamp = currentTime;
+        update.bestBid = bids.getBestPrice();
+        update.bidDepth = bids.getTotalAmount();
+        update.bestAsk = asks.getBestPrice();
+        update.askDepth = asks.getTotalAmount();
+
+        gateway.publishMarketData(update);
+    }
 }
 
 void MerkelMain::goToNextTimeframe()
 {
     std::cout << "Going to next time frame." << std::endl;
 
-    for (std::string& product : orderBook.getKnownProducts())
+    processOrderQueue();
+
+    if (agentWallets.getAgentCount() > 0)
+        generateAgentOrders();
+
+    std::vector<OrderBookEntry> agentSales;
+
+    for (const std::string& product : orderBook.getKnownProducts())
     {
         std::cout << "Matching " << product << std::endl;
-        std::vector<OrderBookEntry> sales = orderBook.matchAsksToBids(product, currentTime);
+        updateIndicators(product);
+        /** sales between dataset orders are only printed, so a replay doesn't make them at all */
+        std::vector<OrderBookEntry> sales = orderBook.matchAsksToBids(product, currentTime, replaying == false);
         std::cout << "Sales: " << sales.size() << std::endl;
 
         for (OrderBookEntry& sale : sales)
         {
             std::cout << "Sale price: " << sale.price << " amount: " << sale.amount << std::endl;
 
-            if (sale.username != "dataset")
+            /** agents are settled together once every product has been matched */
+            if (sale.agentId != 0)
+                agentSales.push_back(std::move(sale));
+
+            else if (sale.username != "dataset")
             {
                 //update wallet
                 wallet.processSale(sale);
+                salesProcessed++;
             } 
         }
     }
 
+    if (agentSales.empty() == false)
+    {
+        agentWallets.settle(agentSales);
+        std::cout << "Agent fills settled: " << agentSales.size() << std::endl;
+    }
+
+    /** filled, immediate-or-cancel and fill-or-kill orders are done with their funds */
+    for (OrderBookEntry& closed : orderBook.takeClosedOrders())
+        wallet.releaseOrder(closed.orderId);
+
     currentTime = orderBook.getNextTime(currentTime);
+    timeframesProcessed++;
+
+    for (OrderBookEntry& expired : orderBook.expireOrders(timeframesProcessed))
+    {
+        std::cout << "Order " << expired.orderId << " expired." << std::endl;
+        wallet.releaseOrder(expired.orderId);
+    }
+
+    publishToGateway();
+
+    Event event;
+    event.type = EventType::advance;
+    eventLog.append(event);
+    eventLog.flush();
+
+    if (timeframesProcessed % checkpointInterval == 0 && replaying == false)
+        saveCheckpoint();
+}
+
+SimulationState MerkelMain::captureState()
+{
+    SimulationState state;
+
+    state.currentTime = currentTime;
+    state.timeframesProcessed = timeframesProcessed;
+    state.salesProcessed = salesProcessed;
+    state.userOrders = orderBook.getUserOrders();
+    state.balances = wallet.getBalances();
+    agentWallets.exportBalances(state.agentCurrencies, state.agentBalances);
+
+    BinaryWriter indicatorWriter;
+    indicators.save(indicatorWriter);
+    state.indicators = indicatorWriter.getBuffer();
+
+    return state;
+}
+
+void MerkelMain::saveCheckpoint()
+{
+    SimulationState state = captureState();
+
+    /** only the snapshot happens here; the disk write is left to the checkpoint's own thread */
+    checkpoint.writeAsync(checkpointFilename, Checkpoint::serialize(state));
+    std::cout << "Checkpoint taken at " << currentTime << std::endl;
+}
+
+void MerkelMain::restoreCheckpoint()
+{
+    /** make sure we don't read a file that is still being written */
+    checkpoint.wait();
+
+    try
+    {
+        std::string contents = BinaryReader::readFile(checkpointFilename);
+        SimulationState state = Checkpoint::deserialize(contents);
+
+        /** the log keeps the checkpoint itself, since the file may be gone or overwritten by the time of a replay */
+        Event event;
+        event.type = EventType::restore;
+        event.checkpoint = contents;
+        eventLog.append(event);
+        eventLog.flush();
+
+        applyState(state);
+
+        std::cout << "Restored checkpoint at " << currentTime << std::endl;
+    }
+
+    catch(const std::exception& e)
+    {
+        std::cout << "MerkelMain::restoreCheckpoint could not read " << checkpointFilename << std::endl;
+    }
+}
+
+void MerkelMain::applyState(SimulationState& state)
+{
+    /** decode the indicators before touching anything, so a bad blob leaves the sim as it was */
+    IndicatorEngine restoredIndicators;
+    BinaryReader indicatorReader{state.indicators};
+    restoredIndicators.load(indicatorReader);
+
+    currentTime = state.currentTime;
+    timeframesProcessed = state.timeframesProcessed;
+    salesProcessed = state.salesProcessed;
+    orderBook.replaceUserOrders(state.userOrders, timeframesProcessed);
+    wallet.setBalances(state.balances);
+    agentWallets.importBalances(state.agentCurrencies, state.agentBalances);
+    indicators = restoredIndicators;
+
+    /** reservations aren't saved; the resting orders say exactly what they should be */
+    wallet.clearReservations();
+
+    for (OrderBookEntry& order : state.userOrders)
+        wallet.reserveOrder(order);
+}
+
+void MerkelMain::printStateDigest(uint64_t sequence)
+{
+    /** FNV-1a over the same bytes a checkpoint would hold, so two runs agree only if their whole state does */
+    SimulationState state = captureState();
+    std::string bytes = Checkpoint::serialize(state);
+    uint64_t digest = 14695981039346656037ULL;
+
+    for (char byte : bytes)
+    {
+        digest ^= static_cast<uint8_t>(byte);
+        digest *= 1099511628211ULL;
+    }
+
+    std::cout << "State after event " << sequence << " at " << currentTime
+              << ": " << timeframesProcessed << " timeframes, " << salesProcessed << " sales, "
+              << orderBook.getUserOrders().size() << " resting orders, "
+              << agentWallets.getAgentCount() << " agents" << std::endl;
+
+    std::cout << "State digest: " << std::hex << digest << std::dec << std::endl;
+}
+
+void MerkelMain::replay(const std::string& filename, uint64_t lastSequence)
+{
+    replaying = true;
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::vector<OrderBookEntry> dataset;
+    uint64_t applied = 0;
+
+    /** the matching loop prints as it goes; silence it rather than pay for the formatting */
+    std::streambuf* output = std::cout.rdbuf(nullptr);
+
+    try
+    {
+        EventLogReader reader{filename};
+        Event event;
+
+        /** events go through the same paths as in the live run; no log is open, so they aren't recorded again */
+        while (reader.next(event) && (lastSequence == 0 || event.sequence <= lastSequence))
+        {
+            applied++;
+
+            /** the dataset leads the log; it goes into the book in one batch */
+            if (event.type == EventType::datasetOrder)
+            {
+                dataset.push_back(event.command.order);
+                continue;
+            }
+
+            if (dataset.empty() == false)
+            {
+                orderBook.insertOrders(dataset);
+                dataset.clear();
+                currentTime = orderBook.getEarliestTime();
+            }
+
+            if (event.type == EventType::deposit)
+                deposit(event.currency, event.amount);
+
+            /** a log never holds more commands between timeframes than one drain took, but if the queue
+             *  is full anyway, applying what is queued keeps the commands in order; the next step drains the rest */
+            else if (event.type == EventType::command)
+            {
+                if (orderQueue.tryPush(event.command) == false)
+                {
+                    processOrderQueue();
+
+                    if (orderQueue.tryPush(event.command) == false)
+                        throw std::exception{};
+                }
+            }
+
+            else if (event.type == EventType::spawnAgents)
+                addAgents(event.agentCount, event.balances);
+
+            /** the ids are taken again inside the step; all that's needed is for the counter to be there */
+            else if (event.type == EventType::agentOrders)
+                orderBook.skipOrderIdsTo(event.firstOrderId);
+
+            else if (event.type == EventType::advance)
+                goToNextTimeframe();
+
+            else if (event.type == EventType::restore)
+            {
+                SimulationState state = Checkpoint::deserialize(event.checkpoint);
+                applyState(state);
+            }
+        }
+
+        if (dataset.empty() == false)
+        {
+            orderBook.insertOrders(dataset);
+            currentTime = orderBook.getEarliestTime();
+        }
+
+        std::cout.rdbuf(output);
+        std::cout.clear();
+    }
+
+    catch(const std::exception& e)
+    {
+        std::cout.rdbuf(output);
+        std::cout.clear();
+        std::cout << "MerkelMain::replay could not read " << filename << " after event " << applied << std::endl;
+        return;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << "Replayed " << applied << " events in " << elapsed << "s" << std::endl;
+    printStateDigest(applied);
 }
 
 void MerkelMain::exitApp()
 {
     std::cout << "Exitting..." << std::endl;
+
+    /** exit() skips destructors, so finish any checkpoint write, the log and the gateway by hand */
+    checkpoint.wait();
+    eventLog.flush();
+    gateway.stop();
     exit(0);
 }
 
@@ -247,4 +1020,44 @@ void MerkelMain::processOption(int userOption)
     {
         exitApp();
     }
+
+    else if (userOption == 8)
+    {
+        restoreCheckpoint();
+    }
+
+    else if (userOption == 9)
+    {
+        enterCancel();
+    }
+
+    else if (userOption == 10)
+    {
+        startGateway();
+    }
+
+    else if (userOption == 11)
+    {
+        spawnAgents();
+    }
+
+    else if (userOption == 12)
+    {
+        writeArchive();
+    }
+
+    else if (userOption == 13)
+    {
+        queryArchive();
+    }
+
+    else if (userOption == 14)
+    {
+        queryOrders();
+    }
+
+    else if (userOption == 15)
+    {
+        printStateDigest(eventLog.getSequence());
+    }
 }
\ No newline at end of file
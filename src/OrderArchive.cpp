@@ -0,0 +1,452 @@
+
+#include "../headers/OrderArchive.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+#include <cctype>
+
+/** "MRKA"; see BinaryIO.h for the header every file starts with */
+static const uint32_t ARCHIVE_MAGIC = 0x414B524D;
+static const uint32_t ARCHIVE_VERSION = 2;
+
+/** scaling up is done in long double so large amounts with eight decimals still land on the right integer */
+static const long double FIXED_POINT_SCALE = 1e8L;
+
+uint64_t OrderArchive::write(const std::string& filename, std::vector<OrderBookEntry>& orders)
+{
+    /** sorted so that product ids keep the order of the names */
+    std::vector<std::string> products;
+
+    for (OrderBookEntry& order : orders)
+        products.push_back(order.product);
+
+    std::sort(products.begin(), products.end());
+    products.erase(std::unique(products.begin(), products.end()), products.end());
+
+    /** cluster the rows by product, keeping them in time order within each product, so a chunk holds
+     *  a single product and a product filter skips every other chunk on its zone map alone */
+    std::vector<uint32_t> productIds(orders.size());
+    std::vector<size_t> rows(orders.size());
+
+    for (size_t i = 0; i < orders.size(); i++)
+    {
+        productIds[i] = std::lower_bound(products.begin(), products.end(), orders[i].product) - products.begin();
+        rows[i] = i;
+    }
+
+    std::stable_sort(rows.begin(), rows.end(), [&productIds](size_t a, size_t b) { return productIds[a] < productIds[b]; });
+
+    BinaryWriter writer;
+    writer.writeUInt32(ARCHIVE_MAGIC);
+    writer.writeUInt32(ARCHIVE_VERSION);
+
+    std::vector<ChunkIndex> chunks;
+
+    for (size_t start = 0; start < rows.size();)
+    {
+        /** a chunk ends at chunkRows or where the product changes */
+        uint32_t productId = productIds[rows[start]];
+        size_t end = start;
+
+        while (end < rows.size() && end - start < chunkRows && productIds[rows[end]] == productId)
+            end++;
+
+        ChunkIndex index;
+        index.product = productId;
+        index.offset = writer.getBuffer().size();
+        writer.getBuffer() += encodeChunk(orders, rows, start, end, index);
+        chunks.push_back(index);
+
+        start = end;
+    }
+
+    /** the footer holds everything a reader needs before touching any chunk,
+     *  and the last eight bytes of the file say where it starts */
+    uint64_t footerOffset = writer.getBuffer().size();
+
+    writer.writeUInt32(products.size());
+
+    for (std::string& product : products)
+        writer.writeString(product);
+
+    writer.writeUInt32(chunks.size());
+
+    for (ChunkIndex& index : chunks)
+    {
+        writer.writeUInt64(index.offset);
+        writer.writeUInt32(index.rows);
+        writer.writeUInt32(index.product);
+        writer.writeUInt64(index.minTime);
+        writer.writeUInt64(index.maxTime);
+        writer.writeUInt64(index.minPrice);
+        writer.writeUInt64(index.maxPrice);
+
+        for (uint32_t length : index.columnLengths)
+            writer.writeUInt32(length);
+    }
+
+    writer.writeUInt64(footerOffset);
+
+    std::ofstream file{filename, std::ios::binary | std::ios::trunc};
+
+    if (file.is_open() == false)
+        throw std::exception{};
+
+    file.write(writer.getBuffer().data(), writer.getBuffer().size());
+
+    if (file.good() == false)
+        throw std::exception{};
+
+    return writer.getBuffer().size();
+}
+
+std::vector<OrderBookEntry> OrderArchive::query(const std::string& filename, const ArchiveQuery& query, ArchiveScanStats& stats)
+{
+    std::vector<OrderBookEntry> results;
+    std::ifstream file{filename, std::ios::binary};
+
+    if (file.is_open() == false)
+        throw std::exception{};
+
+    std::string header(8, '\0');
+    file.read(&header[0], header.size());
+
+    BinaryReader headerReader{header};
+
+    if (file.gcount() != 8 || headerReader.readUInt32() != ARCHIVE_MAGIC || headerReader.readUInt32() != ARCHIVE_VERSION)
+        throw std::exception{};
+
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = file.tellg();
+
+    if (fileSize < 16)
+        throw std::exception{};
+
+    std::string trailer(8, '\0');
+    file.seekg(fileSize - 8);
+    file.read(&trailer[0], trailer.size());
+
+    BinaryReader trailerReader{trailer};
+    uint64_t footerOffset = trailerReader.readUInt64();
+
+    if (footerOffset < 8 || footerOffset > fileSize - 8)
+        throw std::exception{};
+
+    std::string footer(fileSize - 8 - footerOffset, '\0');
+    file.seekg(footerOffset);
+    file.read(&footer[0], footer.size());
+
+    BinaryReader footerReader{footer};
+    std::vector<std::string> products(footerReader.readUInt32());
+
+    for (std::string& product : products)
+        product = footerReader.readString();
+
+    std::vector<ChunkIndex> chunks(footerReader.readUInt32());
+
+    for (ChunkIndex& index : chunks)
+    {
+        index.offset = footerReader.readUInt64();
+        index.rows = footerReader.readUInt32();
+        index.product = footerReader.readUInt32();
+        index.minTime = footerReader.readUInt64();
+        index.maxTime = footerReader.readUInt64();
+        index.minPrice = footerReader.readUInt64();
+        index.maxPrice = footerReader.readUInt64();
+
+        uint64_t length = 0;
+
+        for (uint32_t& columnLength : index.columnLengths)
+        {
+            columnLength = footerReader.readUInt32();
+            length += columnLength;
+        }
+
+        if (index.product >= products.size() || index.offset + length > footerOffset)
+            throw std::exception{};
+    }
+
+    stats.chunksTotal = chunks.size();
+    stats.bytesRead += header.size() + trailer.size() + footer.size();
+
+    /** turn the query into the same integer domain the zone maps use */
+    uint32_t productId = 0;
+    bool filterProduct = query.product != "";
+
+    if (filterProduct)
+    {
+        std::vector<std::string>::iterator found = std::lower_bound(products.begin(), products.end(), query.product);
+
+        if (found == products.end() || *found != query.product)
+            return results;
+
+        productId = found - products.begin();
+    }
+
+    int64_t minTime = query.startTime != "" ? parseTimestamp(query.startTime) : std::numeric_limits<int64_t>::min();
+    int64_t maxTime = query.endTime != "" ? parseTimestamp(query.endTime) : std::numeric_limits<int64_t>::max();
+    int64_t minPrice = query.minPrice > 0 ? toFixed(query.minPrice) : std::numeric_limits<int64_t>::min();
+    int64_t maxPrice = query.maxPrice > 0 ? toFixed(query.maxPrice) : std::numeric_limits<int64_t>::max();
+
+    /** chunks are clustered by product rather than time, so results are put back in time order at the end */
+    std::vector<std::pair<int64_t, OrderBookEntry>> found;
+
+    for (ChunkIndex& index : chunks)
+    {
+        if (index.maxTime < minTime || index.minTime > maxTime)
+            continue;
+
+        if (filterProduct && index.product != productId)
+            continue;
+
+        if (index.maxPrice < minPrice || index.minPrice > maxPrice)
+            continue;
+
+        stats.chunksRead++;
+
+        /** each column is read only once some row has survived the columns before it */
+        std::string timeColumn = readColumn(file, index, timeColumnIndex, stats);
+
+        std::vector<int64_t> times(index.rows);
+        std::vector<bool> matches(index.rows);
+        size_t matchCount = 0;
+
+        BinaryReader timeReader{timeColumn};
+        int64_t time = 0;
+
+        for (uint32_t row = 0; row < index.rows; row++)
+        {
+            time += unzigzag(timeReader.readVarint());
+            times[row] = time;
+            matches[row] = time >= minTime && time <= maxTime;
+            matchCount += matches[row];
+        }
+
+        stats.rowsDecoded += index.rows;
+
+        if (matchCount == 0)
+            continue;
+
+        std::string priceColumn = readColumn(file, index, priceColumnIndex, stats);
+        BinaryReader priceReader{priceColumn};
+        std::vector<int64_t> prices(index.rows);
+        int64_t price = 0;
+
+        for (uint32_t row = 0; row < index.rows; row++)
+        {
+            price += unzigzag(priceReader.readVarint());
+            prices[row] = price;
+
+            if (matches[row] && (price < minPrice || price > maxPrice))
+            {
+                matches[row] = false;
+                matchCount--;
+            }
+        }
+
+        if (matchCount == 0)
+            continue;
+
+        std::string sideColumn = readColumn(file, index, sideColumnIndex, stats);
+        std::string amountColumn = readColumn(file, index, amountColumnIndex, stats);
+        BinaryReader sideReader{sideColumn};
+        BinaryReader amountReader{amountColumn};
+
+        for (uint32_t row = 0; row < index.rows; row++)
+        {
+            uint8_t side = sideReader.readUInt8();
+            int64_t amount = unzigzag(amountReader.readVarint());
+
+            if (side > static_cast<uint8_t>(OrderBookType::unknown))
+                throw std::exception{};
+
+            if (matches[row] == false)
+                continue;
+
+            found.push_back(std::make_pair(times[row], OrderBookEntry{
+                fromFixed(prices[row]),
+                fromFixed(amount),
+                formatTimestamp(times[row]),
+                products[index.product],
+                static_cast<OrderBookType>(side)
+            }));
+        }
+    }
+
+    std::stable_sort(found.begin(), found.end(),
+        [](const std::pair<int64_t, OrderBookEntry>& a, const std::pair<int64_t, OrderBookEntry>& b) { return a.first < b.first; });
+
+    results.reserve(found.size());
+
+    for (std::pair<int64_t, OrderBookEntry>& entry : found)
+        results.push_back(std::move(entry.second));
+
+    return results;
+}
+
+std::string OrderArchive::encodeChunk(
+    std::vector<OrderBookEntry>& orders,
+    std::vector<size_t>& rows,
+    size_t start,
+    size_t end,
+    ChunkIndex& index
+)
+{
+    BinaryWriter columns[columnCount];
+
+    index.rows = end - start;
+    index.minTime = std::numeric_limits<int64_t>::max();
+    index.maxTime = std::numeric_limits<int64_t>::min();
+    index.minPrice = std::numeric_limits<int64_t>::max();
+    index.maxPrice = std::numeric_limits<int64_t>::min();
+
+    /** every chunk starts its deltas from zero so it can be decoded on its own */
+    int64_t lastTime = 0;
+    int64_t lastPrice = 0;
+
+    for (size_t i = start; i < end; i++)
+    {
+        OrderBookEntry& order = orders[rows[i]];
+
+        int64_t time = parseTimestamp(order.timestamp);
+        int64_t price = toFixed(order.price);
+
+        columns[timeColumnIndex].writeVarint(zigzag(time - lastTime));
+        columns[priceColumnIndex].writeVarint(zigzag(price - lastPrice));
+        columns[sideColumnIndex].writeUInt8(static_cast<uint8_t>(order.orderType));
+        columns[amountColumnIndex].writeVarint(zigzag(toFixed(order.amount)));
+
+        lastTime = time;
+        lastPrice = price;
+
+        index.minTime = std::min(index.minTime, time);
+        index.maxTime = std::max(index.maxTime, time);
+        index.minPrice = std::min(index.minPrice, price);
+        index.maxPrice = std::max(index.maxPrice, price);
+    }
+
+    /** the columns are stored back to back; their lengths in the footer locate each one */
+    std::string chunk;
+
+    for (unsigned int column = 0; column < columnCount; column++)
+    {
+        index.columnLengths[column] = columns[column].getBuffer().size();
+        chunk += columns[column].getBuffer();
+    }
+
+    return chunk;
+}
+
+std::string OrderArchive::readColumn(std::ifstream& file, ChunkIndex& index, unsigned int column, ArchiveScanStats& stats)
+{
+    uint64_t offset = index.offset;
+
+    for (unsigned int before = 0; before < column; before++)
+        offset += index.columnLengths[before];
+
+    std::string contents(index.columnLengths[column], '\0');
+    file.seekg(offset);
+    file.read(&contents[0], contents.size());
+
+    if (file.gcount() != static_cast<std::streamsize>(contents.size()))
+        throw std::exception{};
+
+    stats.bytesRead += contents.size();
+    return contents;
+}
+
+int64_t OrderArchive::parseTimestamp(const std::string& timestamp)
+{
+    int year, month, day, hour, minute, second;
+    int consumed = 0;
+
+    if (std::sscanf(timestamp.c_str(), "%d/%d/%d %d:%d:%d%n", &year, &month, &day, &hour, &minute, &second, &consumed) != 6)
+        throw std::exception{};
+
+    /** the fraction is optional and may have fewer than six digits */
+    int64_t micros = 0;
+    int digits = 0;
+
+    if (timestamp[consumed] == '.')
+    {
+        for (size_t i = consumed + 1; i < timestamp.size() && std::isdigit(timestamp[i]); i++)
+        {
+            if (digits < 6)
+            {
+                micros = micros * 10 + (timestamp[i] - '0');
+                digits++;
+            }
+        }
+    }
+
+    for (; digits < 6; digits++)
+        micros *= 10;
+
+    /** days since 1970/01/01 in the proleptic Gregorian calendar */
+    int64_t y = month <= 2 ? year - 1 : year;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yearOfEra = y - era * 400;
+    int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    int64_t days = era * 146097 + dayOfEra - 719468;
+
+    return ((days * 24 + hour) * 60 + minute) * 60000000LL + second * 1000000LL + micros;
+}
+
+std::string OrderArchive::formatTimestamp(int64_t micros)
+{
+    int64_t days = micros / 86400000000LL;
+    int64_t timeOfDay = micros % 86400000000LL;
+
+    if (timeOfDay < 0)
+    {
+        timeOfDay += 86400000000LL;
+        days--;
+    }
+
+    /** the inverse of the calendar arithmetic in parseTimestamp */
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    int64_t day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    int64_t month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    int64_t year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%04d/%02d/%02d %02d:%02d:%02d.%06d",
+        static_cast<int>(year),
+        static_cast<int>(month),
+        static_cast<int>(day),
+        static_cast<int>(timeOfDay / 3600000000LL),
+        static_cast<int>(timeOfDay / 60000000LL % 60),
+        static_cast<int>(timeOfDay / 1000000LL % 60),
+        static_cast<int>(timeOfDay % 1000000LL));
+
+    return buffer;
+}
+
+uint64_t OrderArchive::zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t OrderArchive::unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+int64_t OrderArchive::toFixed(double value)
+{
+    return std::llround(static_cast<long double>(value) * FIXED_POINT_SCALE);
+}
+
+double OrderArchive::fromFixed(int64_t value)
+{
+    /** one correctly rounded division gives back the same double the csv text parsed to */
+    return static_cast<double>(value) / 1e8;
+}
\ No newline at end of file
@@ -5,153 +5,578 @@
 #include <algorithm>
 
 /** construct, reading a csv data file */
-OrderBook::OrderBook(std::string filename)
+OrderBook::OrderBook(const std::string& filename)
+:   nextOrderId(1)
 {
-    orders = CSVReader::readCSV(filename);
+    if (filename != "")
+        orders = CSVReader::readCSV(filename);
+
+    addKnownProducts(orders.data(), orders.data() + orders.size());
 }
 
 /** return vector of all known products in the dataset */
-std::vector<std::string> OrderBook::getKnownProducts()
+const std::vector<std::string>& OrderBook::getKnownProducts()
 {
-    std::vector<std::string> products;
-    std::map<std::string, bool> productMap;
+    return knownProducts;
+}
 
-    /** initialize map entries with all product types */
-    for (OrderBookEntry& entry : orders)
-        productMap[entry.product] = true;
+/** return vector of Orders according to the sent filters */
+std::vector<OrderBookEntry> OrderBook::getOrders(
+    OrderBookType type, 
+    std::string_view product, 
+    std::string_view timestamp
+)
+{
+    OrderView view = viewOrders(type, product, timestamp);
+
+    return std::vector<OrderBookEntry>(view.begin(), view.end());
+}
+
+OrderView OrderBook::viewOrders(OrderBookType type, std::string_view product, std::string_view timestamp)
+{
+    return OrderView{
+        viewOrdersAt(timestamp),
+        OrderSpan{userOrders.data(), userOrders.data() + userOrders.size()},
+        type,
+        product
+    };
+}
+
+OrderSpan OrderBook::viewOrdersAt(std::string_view timestamp)
+{
+    /** the dataset is sorted by timestamp, so a timestamp's orders sit next to each other */
+    std::vector<OrderBookEntry>::iterator first = std::lower_bound(orders.begin(), orders.end(), timestamp,
+        [](const OrderBookEntry& entry, std::string_view value) { return entry.timestamp < value; });
+
+    std::vector<OrderBookEntry>::iterator last = std::upper_bound(first, orders.end(), timestamp,
+        [](std::string_view value, const OrderBookEntry& entry) { return value < entry.timestamp; });
+
+    return OrderSpan{orders.data() + (first - orders.begin()), orders.data() + (last - orders.begin())};
+}
+
+OrderSpan OrderBook::viewDatasetOrders()
+{
+    return OrderSpan{orders.data(), orders.data() + orders.size()};
+}
+
+const std::string& OrderBook::getEarliestTime()
+{
+    return orders[0].timestamp;
+}
+
+const std::string& OrderBook::getNextTime(std::string_view timestamp)
+{
+    std::vector<OrderBookEntry>::iterator next = std::upper_bound(orders.begin(), orders.end(), timestamp,
+        [](std::string_view value, const OrderBookEntry& entry) { return value < entry.timestamp; });
+
+    /** wrap around in the data back to the earliest timestamp if we're at the end */
+    if (next == orders.end())
+        return OrderBook::getEarliestTime();
+
+    return next->timestamp;
+}
+
+void OrderBook::insertOrder(OrderBookEntry& order)
+{
+    if (order.username != "dataset")
+        addUserOrder(order);
 
-    /** 'auto' lets the compiler deal with the type rather than specifying one */
-    for (auto const& entry : productMap)
+    /** slot the order in after every entry with the same or an earlier timestamp */
+    else
     {
-        /** entry.first is the map key, and entry.last is the actual value of the entry, a boolean */
-        products.push_back(entry.first);
+        orders.insert(
+            std::upper_bound(orders.begin(), orders.end(), order, OrderBookEntry::compareByTimestamp),
+            order
+        );
+
+        datasetRevision++;
     }
 
-    return products;
+    addKnownProducts(&order, &order + 1);
+
+    /** any cached depth may now be stale */
+    markChanged();
 }
 
-/** return vector of Orders according to the sent filters */
-std::vector<OrderBookEntry> OrderBook::getOrders(
-    OrderBookType type, 
-    std::string product, 
-    std::string timestamp
-)
+void OrderBook::insertOrders(std::vector<OrderBookEntry>& batch)
 {
-    std::vector<OrderBookEntry> orders_sub;
+    size_t datasetStart = orders.size();
 
-    for (OrderBookEntry& entry : orders)
+    for (OrderBookEntry& order : batch)
     {
-        if (entry.orderType == type && 
-            entry.product == product && 
-            entry.timestamp == timestamp)
-        {
-            orders_sub.push_back(entry);
-        }
+        if (order.username != "dataset")
+            addUserOrder(order);
+
+        else orders.push_back(order);
     }
 
-    return orders_sub;
+    /** the book is already sorted; sort just the new tail and merge the two */
+    if (orders.size() != datasetStart)
+    {
+        std::stable_sort(orders.begin() + datasetStart, orders.end(), OrderBookEntry::compareByTimestamp);
+        std::inplace_merge(orders.begin(), orders.begin() + datasetStart, orders.end(), OrderBookEntry::compareByTimestamp);
+        datasetRevision++;
+    }
+
+    addKnownProducts(batch.data(), batch.data() + batch.size());
+
+    markChanged();
 }
 
-std::string OrderBook::getEarliestTime()
+bool OrderBook::cancelOrder(uint64_t orderId)
 {
-    return orders[0].timestamp;
+    if (userOrderIndex.count(orderId) == 0)
+        return false;
+
+    removeUserOrder(orderId);
+    markChanged();
+    return true;
 }
 
-std::string OrderBook::getNextTime(std::string timestamp)
+bool OrderBook::amendOrder(uint64_t orderId, double price, double amount)
 {
-    std::string next_timestamp = "";
+    OrderBookEntry* order = findUserOrder(orderId);
 
-    for (OrderBookEntry& entry : orders)
+    if (order == nullptr)
+        return false;
+
+    order->price = price;
+    order->amount = amount;
+    markChanged();
+    return true;
+}
+
+OrderBookEntry* OrderBook::findUserOrder(uint64_t orderId)
+{
+    std::unordered_map<uint64_t, size_t>::iterator position = userOrderIndex.find(orderId);
+
+    if (position == userOrderIndex.end())
+        return nullptr;
+
+    return &userOrders[position->second];
+}
+
+uint64_t OrderBook::allocateOrderId(uint64_t count)
+{
+    return nextOrderId.fetch_add(count);
+}
+
+void OrderBook::skipOrderIdsTo(uint64_t orderId)
+{
+    if (orderId > nextOrderId)
+        nextOrderId = orderId;
+}
+
+std::vector<OrderBookEntry> OrderBook::getUserOrders()
+{
+    return userOrders;
+}
+
+void OrderBook::replaceUserOrders(std::vector<OrderBookEntry>& _userOrders, uint64_t timeframe)
+{
+    userOrders.clear();
+    userOrderIndex.clear();
+    closedOrders.clear();
+    expiryWheel.reset(timeframe);
+
+    for (OrderBookEntry& entry : _userOrders)
     {
-        if (entry.timestamp > timestamp)
-        {
-            next_timestamp = entry.timestamp;
-            break;
-        }
+        addUserOrder(entry);
+
+        /** never hand out an id that a restored order already uses */
+        if (entry.orderId >= nextOrderId)
+            nextOrderId = entry.orderId + 1;
     }
 
-    /** wrap around in the data back to the earliest timestamp if we're at the end */
-    if (next_timestamp == "")
-        next_timestamp = OrderBook::getEarliestTime();
+    markChanged();
+}
+
+std::vector<OrderBookEntry> OrderBook::expireOrders(uint64_t timeframe)
+{
+    std::vector<uint64_t> fired;
+    std::vector<OrderBookEntry> expired;
+
+    expiryWheel.advance(timeframe, fired);
+
+    /** timers are left behind when orders fill or are cancelled, so skip ids no longer in the book */
+    for (uint64_t orderId : fired)
+        if (userOrderIndex.count(orderId) > 0)
+            expired.push_back(removeUserOrder(orderId));
+
+    if (expired.empty() == false)
+        markChanged();
 
-    return next_timestamp;
+    return expired;
 }
 
-void OrderBook::insertOrder(OrderBookEntry& order)
+std::vector<OrderBookEntry> OrderBook::takeClosedOrders()
+{
+    std::vector<OrderBookEntry> closed;
+    closed.swap(closedOrders);
+    return closed;
+}
+
+void OrderBook::addUserOrder(OrderBookEntry& order)
+{
+    userOrderIndex[order.orderId] = userOrders.size();
+    userOrders.push_back(order);
+
+    if (order.timeInForce == TimeInForce::gtt)
+        expiryWheel.schedule(order.orderId, order.expiresAt);
+}
+
+OrderBookEntry OrderBook::removeUserOrder(uint64_t orderId)
+{
+    size_t position = userOrderIndex[orderId];
+    OrderBookEntry removed = userOrders[position];
+
+    /** fill the gap with the last order rather than shifting everything down */
+    if (position != userOrders.size() - 1)
+    {
+        userOrders[position] = userOrders.back();
+        userOrderIndex[userOrders[position].orderId] = position;
+    }
+
+    userOrders.pop_back();
+    userOrderIndex.erase(orderId);
+
+    return removed;
+}
+
+void OrderBook::settleUserOrder(OrderBookEntry& matched)
+{
+    OrderBookEntry* order = findUserOrder(matched.orderId);
+
+    if (order == nullptr)
+        return;
+
+    order->amount = matched.amount;
+
+    /** immediate-or-cancel and fill-or-kill orders never rest past their first match */
+    if (order->amount <= 0 || order->timeInForce == TimeInForce::ioc || order->timeInForce == TimeInForce::fok)
+        closedOrders.push_back(removeUserOrder(matched.orderId));
+}
+
+DepthLadder& OrderBook::getLadder(OrderBookType type, std::string_view product, std::string_view timestamp)
+{
+    if (timestamp != ladderTimestamp)
+    {
+        ladders.clear();
+        ladderTimestamp = timestamp;
+    }
+
+    std::map<std::string, std::map<OrderBookType, DepthLadder>, std::less<>>::iterator sides = ladders.find(product);
+
+    if (sides == ladders.end())
+        sides = ladders.emplace(std::string{product}, std::map<OrderBookType, DepthLadder>{}).first;
+
+    std::map<OrderBookType, DepthLadder>::iterator cached = sides->second.find(type);
+
+    if (cached != sides->second.end())
+        return cached->second;
+
+    DepthLadder& ladder = sides->second[type];
+    ladder.build(viewOrders(type, sides->first, ladderTimestamp), type);
+
+    return ladder;
+}
+
+/** matching policies. A book policy says what is matched: DatasetOnlyBook only the dataset orders of
+ *  the timestamp, reduced to price and amount since nothing else of them is read, and RestingBook those
+ *  plus every resting user order of the product, settled back into the book afterwards.
+ *  A journal policy says whether fills between two dataset orders are recorded as sales */
+struct Quote
+{
+    Quote(const OrderBookEntry& entry)
+    :   price(entry.price),
+        amount(entry.amount)
+    {
+
+    }
+
+    double price;
+    double amount;
+};
+
+struct DatasetOnlyBook
+{
+    typedef Quote Order;
+    static const bool hasUserOrders = false;
+};
+
+struct RestingBook
+{
+    typedef OrderBookEntry Order;
+    static const bool hasUserOrders = true;
+};
+
+struct JournaledSales
+{
+    static const bool recordsDatasetSales = true;
+};
+
+struct UnjournaledSales
+{
+    static const bool recordsDatasetSales = false;
+};
+
+std::vector<OrderBookEntry> OrderBook::matchAsksToBids(std::string_view product, std::string_view timestamp, bool journalDatasetSales)
 {
-    orders.push_back(order);
-    std::sort(orders.begin(), orders.end(), OrderBookEntry::compareByTimestamp);
+    /** pick the kernel once; the common timeframe has no user orders in the product at all */
+    bool hasUserOrders = std::any_of(userOrders.begin(), userOrders.end(),
+        [product](const OrderBookEntry& entry) { return entry.product == product; });
+
+    if (hasUserOrders)
+    {
+        if (journalDatasetSales)
+            return matchKernel<RestingBook, JournaledSales>(product, timestamp);
+
+        return matchKernel<RestingBook, UnjournaledSales>(product, timestamp);
+    }
+
+    if (journalDatasetSales)
+        return matchKernel<DatasetOnlyBook, JournaledSales>(product, timestamp);
+
+    return matchKernel<DatasetOnlyBook, UnjournaledSales>(product, timestamp);
 }
 
-std::vector<OrderBookEntry> OrderBook::matchAsksToBids(std::string product, std::string timestamp)
+template <typename BookPolicy, typename JournalPolicy>
+std::vector<OrderBookEntry> OrderBook::matchKernel(std::string_view product, std::string_view timestamp)
 {
-    std::vector<OrderBookEntry> asks = getOrders(OrderBookType::ask, product, timestamp);
-    std::vector<OrderBookEntry> bids = getOrders(OrderBookType::bid, product, timestamp);
+    typedef typename BookPolicy::Order Order;
+
+    std::vector<Order> asks;
+    std::vector<Order> bids;
     std::vector<OrderBookEntry> sales;
 
-    /** lowest bids (sells) will be matched to highest asks (buys) in priority */
-    std::sort(asks.begin(), asks.end(), OrderBookEntry::compareByPriceAsc);
-    std::sort(bids.begin(), bids.end(), OrderBookEntry::compareByPriceDesc);
+    /** dataset orders only match in their own timestamp */
+    for (const OrderBookEntry& entry : viewOrdersAt(timestamp))
+    {
+        if (entry.product == product)
+        {
+            if (entry.orderType == OrderBookType::ask)
+                asks.push_back(Order(entry));
+
+            else if (entry.orderType == OrderBookType::bid)
+                bids.push_back(Order(entry));
+        }
+    }
+
+    /** user orders rest until they are filled, cancelled or expire */
+    bool hasFillOrKill = false;
+
+    if constexpr (BookPolicy::hasUserOrders)
+    {
+        for (OrderBookEntry& entry : userOrders)
+        {
+            if (entry.product == product)
+            {
+                if (entry.orderType == OrderBookType::ask)
+                    asks.push_back(entry);
+
+                else if (entry.orderType == OrderBookType::bid)
+                    bids.push_back(entry);
+
+                if (entry.timeInForce == TimeInForce::fok)
+                    hasFillOrKill = true;
+            }
+        }
+    }
+
+    /** lowest bids (sells) will be matched to highest asks (buys) in priority;
+     *  the comparisons only look at the price, so either kind of order sorts into the same sequence */
+    std::sort(asks.begin(), asks.end(), [](const Order& a, const Order& b) { return a.price < b.price; });
+    std::sort(bids.begin(), bids.end(), [](const Order& a, const Order& b) { return a.price > b.price; });
+
+    if (hasFillOrKill == false)
+        fillOrders<BookPolicy, JournalPolicy>(asks, bids, sales, product, timestamp);
+
+    /** whether a fill-or-kill order fills depends on every order ranked ahead of it, so it is decided on
+     *  the fill itself: match copies, and if any fill-or-kill order is left short, kill it and match
+     *  again without it, until every one that is left fills completely */
+    else if constexpr (BookPolicy::hasUserOrders)
+    {
+        while (true)
+        {
+            std::vector<Order> filledAsks = asks;
+            std::vector<Order> filledBids = bids;
+            sales.clear();
+
+            fillOrders<BookPolicy, JournalPolicy>(filledAsks, filledBids, sales, product, timestamp);
+
+            std::vector<uint64_t> killed;
+
+            for (std::vector<Order>* side : {&filledAsks, &filledBids})
+                for (Order& order : *side)
+                    if (order.timeInForce == TimeInForce::fok && order.amount > 0)
+                        killed.push_back(order.orderId);
+
+            if (killed.empty())
+            {
+                asks.swap(filledAsks);
+                bids.swap(filledBids);
+                break;
+            }
+
+            for (uint64_t orderId : killed)
+            {
+                for (std::vector<Order>* side : {&asks, &bids})
+                    side->erase(std::remove_if(side->begin(), side->end(),
+                        [orderId](const Order& order) { return order.orderId == orderId; }), side->end());
+
+                closedOrders.push_back(removeUserOrder(orderId));
+            }
+
+            markChanged();
+        }
+    }
 
-    for (OrderBookEntry& ask : asks)
+    /** write back what is left of the user orders */
+    if constexpr (BookPolicy::hasUserOrders)
     {
+        bool settledUserOrders = false;
+
+        for (OrderBookEntry& ask : asks)
+        {
+            if (ask.orderId != 0)
+            {
+                settleUserOrder(ask);
+                settledUserOrders = true;
+            }
+        }
+
         for (OrderBookEntry& bid : bids)
         {
-            if (bid.price >= ask.price)
+            if (bid.orderId != 0)
             {
-                OrderBookEntry sale{ask.price, 0, timestamp, product, OrderBookType::asksale};
+                settleUserOrder(bid);
+                settledUserOrders = true;
+            }
+        }
 
-                /** the user is placing a bid against the dataset, thus this will result in a bidsale */
-                if (bid.username != "dataset")
-                {
-                    sale.username = "simuser";
-                    sale.orderType = OrderBookType::bidsale;
-                }
+        if (settledUserOrders)
+            markChanged();
+    }
 
-                /** the user is placing an ask against the dataset, thus this will result in an asksale */
-                else if (ask.username != "dataset")
-                {
-                    sale.username = "simuser";
-                    sale.orderType = OrderBookType::asksale;
-                }
+    return sales;
+}
 
-                /** both bid and ask are fully matched; both get wiped */
-                if (bid.amount == ask.amount)
-                {
-                    sale.amount = ask.amount;
-                    sales.push_back(sale);
+template <typename BookPolicy, typename JournalPolicy>
+void OrderBook::fillOrders(
+    std::vector<typename BookPolicy::Order>& asks,
+    std::vector<typename BookPolicy::Order>& bids,
+    std::vector<OrderBookEntry>& sales,
+    std::string_view product,
+    std::string_view timestamp
+)
+{
+    typedef typename BookPolicy::Order Order;
 
-                    bid.amount = 0;
-                    ask.amount = 0;
-                    break;
-                }
+    /** bids fill strictly in order, so the ones used up in front never need looking at again */
+    size_t firstBid = 0;
 
-                /** more product being bought than sold; bid gets sliced by the ask amount, and ask gets wiped */
-                if (bid.amount > ask.amount)
-                {
-                    sale.amount = ask.amount;
-                    sales.push_back(sale);
+    for (Order& ask : asks)
+    {
+        /** bids are sorted highest first, so the first one below the ask ends the search */
+        for (size_t i = firstBid; i < bids.size() && bids[i].price >= ask.price; i++)
+        {
+            Order& bid = bids[i];
 
-                    bid.amount -= ask.amount;
-                    ask.amount = 0;
-                    break;
-                }
+            /** whichever side is smaller is wiped, and the other is sliced by it */
+            double amount = std::min(bid.amount, ask.amount);
 
-                /** more product being sold than bought; bid gets wiped and ask gets sliced by the bid amount */
-                if (bid.amount < ask.amount && bid.amount > 0)
+            if (amount > 0)
+            {
+                if constexpr (BookPolicy::hasUserOrders)
                 {
-                    sale.amount = bid.amount;
-                    sales.push_back(sale);
-
-                    ask.amount -= bid.amount;
-                    bid.amount = 0;
-                    continue;
+                    if (JournalPolicy::recordsDatasetSales || bid.orderId != 0 || ask.orderId != 0)
+                        recordSales(sales, ask, bid, amount, timestamp);
                 }
+
+                else if constexpr (JournalPolicy::recordsDatasetSales)
+                    sales.push_back(OrderBookEntry{ask.price, amount, std::string{timestamp}, std::string{product}, OrderBookType::asksale});
             }
+
+            bid.amount -= amount;
+            ask.amount -= amount;
+
+            if (ask.amount == 0)
+                break;
         }
+
+        while (firstBid < bids.size() && bids[firstBid].amount == 0)
+            firstBid++;
     }
+}
 
-    return sales;
+void OrderBook::recordSales(
+    std::vector<OrderBookEntry>& sales, 
+    OrderBookEntry& ask, 
+    OrderBookEntry& bid, 
+    double amount, 
+    std::string_view timestamp
+)
+{
+    bool userBid = bid.username != "dataset";
+    bool userAsk = ask.username != "dataset";
+
+    /** the dataset trading with itself; recorded for the stats only */
+    if (userBid == false && userAsk == false)
+    {
+        sales.push_back(OrderBookEntry{ask.price, amount, std::string{timestamp}, ask.product, OrderBookType::asksale});
+        return;
+    }
+
+    /** a user or agent bid was filled, thus this will result in a bidsale for its owner */
+    if (userBid)
+    {
+        OrderBookEntry sale{ask.price, amount, std::string{timestamp}, ask.product, OrderBookType::bidsale, bid.username};
+        sale.orderId = bid.orderId;
+        sale.agentId = bid.agentId;
+        sales.push_back(sale);
+    }
+
+    /** a user or agent ask was filled, thus this will result in an asksale for its owner;
+     *  when both sides belong to users, each owner gets their own sale */
+    if (userAsk)
+    {
+        OrderBookEntry sale{ask.price, amount, std::string{timestamp}, ask.product, OrderBookType::asksale, ask.username};
+        sale.orderId = ask.orderId;
+        sale.agentId = ask.agentId;
+        sales.push_back(sale);
+    }
+}
+
+OrderQueryResult OrderBook::queryOrders(const OrderQuery& query)
+{
+    /** the dataset only changes when dataset orders are inserted, so its large index outlives the
+     *  user orders' small one, which is rebuilt after every change to the book */
+    if (indexedDatasetRevision != datasetRevision)
+    {
+        datasetQueries.build(viewDatasetOrders());
+        indexedDatasetRevision = datasetRevision;
+    }
+
+    if (indexedRevision != revision)
+    {
+        userQueries.build(OrderSpan{userOrders.data(), userOrders.data() + userOrders.size()});
+        indexedRevision = revision;
+    }
+
+    OrderQueryResult datasetResult = datasetQueries.run(query);
+    OrderQueryResult userResult = userQueries.run(query);
+
+    return OrderQueryEngine::combine(datasetResult, userResult, query.rowLimit);
+}
+
+uint64_t OrderBook::writeArchive(const std::string& filename)
+{
+    return OrderArchive::write(filename, orders);
+}
+
+std::vector<OrderBookEntry> OrderBook::queryArchive(const std::string& filename, const ArchiveQuery& query, ArchiveScanStats& stats)
+{
+    return OrderArchive::query(filename, query, stats);
 }
 
 double OrderBook::getHighPrice(std::vector<OrderBookEntry>& orders)
@@ -165,6 +590,22 @@ double OrderBook::getHighPrice(std::vector<OrderBookEntry>& orders)
     return max;
 }
 
+double OrderBook::getHighPrice(const OrderView& orders)
+{
+    double max = 0;
+    bool first = true;
+
+    for (const OrderBookEntry& entry : orders)
+    {
+        if (first || entry.price > max)
+            max = entry.price;
+
+        first = false;
+    }
+
+    return max;
+}
+
 double OrderBook::getLowPrice(std::vector<OrderBookEntry>& orders)
 {
     double min = orders[0].price;
@@ -174,4 +615,37 @@ double OrderBook::getLowPrice(std::vector<OrderBookEntry>& orders)
             min = entry.price;
 
     return min;
+}
+
+double OrderBook::getLowPrice(const OrderView& orders)
+{
+    double min = 0;
+    bool first = true;
+
+    for (const OrderBookEntry& entry : orders)
+    {
+        if (first || entry.price < min)
+            min = entry.price;
+
+        first = false;
+    }
+
+    return min;
+}
+
+void OrderBook::markChanged()
+{
+    ladders.clear();
+    revision++;
+}
+
+void OrderBook::addKnownProducts(const OrderBookEntry* first, const OrderBookEntry* last)
+{
+    for (const OrderBookEntry* entry = first; entry != last; entry++)
+    {
+        std::vector<std::string>::iterator position = std::lower_bound(knownProducts.begin(), knownProducts.end(), entry->product);
+
+        if (position == knownProducts.end() || *position != entry->product)
+            knownProducts.insert(position, entry->product);
+    }
 }
\ No newline at end of file
@@ -21,7 +21,11 @@ OrderBookEntry::OrderBookEntry(
     timestamp(_timestamp), 
     product(_product), 
     orderType(_orderType), 
-    username(_username)
+    username(_username),
+    orderId(0),
+    timeInForce(TimeInForce::gtc),
+    expiresAt(0),
+    agentId(0)
 {
 
 }
@@ -37,17 +41,34 @@ OrderBookType OrderBookEntry::stringToOrderBookType(std::string s)
     else return OrderBookType::unknown;
 }
 
-bool OrderBookEntry::compareByTimestamp(OrderBookEntry& e1, OrderBookEntry& e2)
+TimeInForce OrderBookEntry::stringToTimeInForce(std::string s)
+{
+    if (s == "GTC")
+        return TimeInForce::gtc;
+
+    if (s == "IOC")
+        return TimeInForce::ioc;
+
+    if (s == "FOK")
+        return TimeInForce::fok;
+
+    if (s == "GTT")
+        return TimeInForce::gtt;
+
+    throw std::exception{};
+}
+
+bool OrderBookEntry::compareByTimestamp(const OrderBookEntry& e1, const OrderBookEntry& e2)
 {
     return e1.timestamp < e2.timestamp;
 }
 
-bool OrderBookEntry::compareByPriceAsc(OrderBookEntry& e1, OrderBookEntry& e2)
+bool OrderBookEntry::compareByPriceAsc(const OrderBookEntry& e1, const OrderBookEntry& e2)
 {
     return e1.price < e2.price;
 }
 
-bool OrderBookEntry::compareByPriceDesc(OrderBookEntry& e1, OrderBookEntry& e2)
+bool OrderBookEntry::compareByPriceDesc(const OrderBookEntry& e1, const OrderBookEntry& e2)
 {
     return e1.price > e2.price;
 }
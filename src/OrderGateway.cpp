@@ -0,0 +1,480 @@
+
+#include "../headers/OrderGateway.h"
+#include "../headers/Wallet.h"
+#include <iostream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#endif
+
+/** a client that lets this much output pile up is too slow to keep */
+static const size_t MAX_OUTPUT_BUFFERED = 4 * 1024 * 1024;
+
+/** one wakeup reads at most this much from a client, so a fast sender can't starve the others;
+ *  epoll is level-triggered, so whatever is left wakes the loop again */
+static const size_t MAX_READ_PER_WAKEUP = 256 * 1024;
+
+/** unparsed input never needs to hold more than a wakeup's worth on top of one partial frame and its header */
+static const size_t MAX_INPUT_BUFFERED = MAX_READ_PER_WAKEUP + 2 * GatewayProtocol::maxFrameSize;
+
+OrderGateway::OrderGateway(OrderQueue<OrderCommand>& _orderQueue, OrderBook& _orderBook)
+:   orderQueue(_orderQueue),
+    orderBook(_orderBook),
+    listenFd(-1),
+    epollFd(-1),
+    wakeFd(-1),
+    running(false),
+    requestCount(0)
+{
+
+}
+
+OrderGateway::~OrderGateway()
+{
+    stop();
+}
+
+#ifdef __linux__
+
+bool OrderGateway::start(const std::string& _socketPath)
+{
+    if (running)
+        return true;
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (_socketPath.size() >= sizeof(address.sun_path))
+    {
+        std::cout << "OrderGateway::start socket path is too long: " << _socketPath << std::endl;
+        return false;
+    }
+
+    std::strcpy(address.sun_path, _socketPath.c_str());
+    socketPath = _socketPath;
+
+    /** a socket file left behind by a previous run would make bind fail */
+    unlink(socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+
+    if (listenFd < 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0)
+    {
+        std::cout << "OrderGateway::start could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+
+        if (listenFd >= 0)
+            close(listenFd);
+
+        listenFd = -1;
+        return false;
+    }
+
+    epollFd = epoll_create1(0);
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+
+    epoll_event event;
+    event.events = EPOLLIN;
+
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    running = true;
+    loop = std::thread{&OrderGateway::runLoop, this};
+
+    std::cout << "Order gateway listening on " << socketPath << std::endl;
+    return true;
+}
+
+void OrderGateway::stop()
+{
+    if (running == false)
+        return;
+
+    running = false;
+
+    uint64_t wake = 1;
+    ssize_t written = write(wakeFd, &wake, sizeof(wake));
+    (void) written;
+
+    loop.join();
+
+    for (std::pair<const int, Connection>& connection : connections)
+        close(connection.first);
+
+    connections.clear();
+
+    close(listenFd);
+    close(epollFd);
+    close(wakeFd);
+    unlink(socketPath.c_str());
+
+    listenFd = epollFd = wakeFd = -1;
+}
+
+void OrderGateway::publishMarketData(GatewayMessage& update)
+{
+    if (running == false)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock{publishMutex};
+        pendingMarketData.push_back(update);
+    }
+
+    uint64_t wake = 1;
+    ssize_t written = write(wakeFd, &wake, sizeof(wake));
+    (void) written;
+}
+
+void OrderGateway::runLoop()
+{
+    const int maxEvents = 64;
+    epoll_event events[maxEvents];
+
+    while (running)
+    {
+        int count = epoll_wait(epollFd, events, maxEvents, -1);
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            std::cout << "OrderGateway::runLoop epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            int fd = events[i].data.fd;
+
+            if (fd == listenFd)
+                acceptClients();
+
+            else if (fd == wakeFd)
+            {
+                uint64_t wakes;
+                ssize_t result = read(wakeFd, &wakes, sizeof(wakes));
+                (void) result;
+
+                deliverMarketData();
+            }
+
+            else if (events[i].events & (EPOLLHUP | EPOLLERR))
+                closeClient(fd);
+
+            else
+            {
+                if (events[i].events & EPOLLIN)
+                    readClient(fd);
+
+                /** reading may have dropped the client */
+                if ((events[i].events & EPOLLOUT) && connections.count(fd) > 0)
+                    writeClient(fd);
+            }
+        }
+    }
+}
+
+void OrderGateway::acceptClients()
+{
+    while (true)
+    {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+
+        if (fd < 0)
+            return;
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+
+        connections[fd] = Connection{};
+    }
+}
+
+void OrderGateway::readClient(int fd)
+{
+    Connection& connection = connections[fd];
+    char buffer[64 * 1024];
+    size_t receivedTotal = 0;
+
+    /** take what the client has sent, up to the wakeup limit, so pipelined requests are handled as one batch */
+    while (receivedTotal < MAX_READ_PER_WAKEUP)
+    {
+        ssize_t received = read(fd, buffer, std::min(sizeof(buffer), MAX_READ_PER_WAKEUP - receivedTotal));
+
+        if (received > 0)
+        {
+            connection.input.append(buffer, received);
+            receivedTotal += received;
+        }
+
+        else if (received == 0)
+        {
+            closeClient(fd);
+            return;
+        }
+
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+
+        else if (errno != EINTR)
+        {
+            closeClient(fd);
+            return;
+        }
+    }
+
+    if (connection.input.size() > MAX_INPUT_BUFFERED)
+    {
+        std::cout << "OrderGateway dropping a client that sent more than it can buffer" << std::endl;
+        closeClient(fd);
+        return;
+    }
+
+    size_t offset = 0;
+    std::string payload;
+
+    try
+    {
+        while (GatewayProtocol::extractFrame(connection.input, offset, payload))
+        {
+            GatewayMessage request;
+
+            try
+            {
+                request = GatewayProtocol::decode(payload);
+            }
+
+            catch(const std::exception& e)
+            {
+                /** a bad payload inside a well-formed frame only costs that one request */
+                GatewayMessage response;
+                response.status = GatewayStatus::badRequest;
+                connection.output += GatewayProtocol::encode(response);
+                continue;
+            }
+
+            handleRequest(connection, request);
+        }
+    }
+
+    catch(const std::exception& e)
+    {
+        /** an oversized frame means we've lost track of the stream */
+        closeClient(fd);
+        return;
+    }
+
+    connection.input.erase(0, offset);
+
+    /** all the responses to this batch go out in a single write */
+    writeClient(fd);
+}
+
+void OrderGateway::writeClient(int fd)
+{
+    Connection& connection = connections[fd];
+
+    while (connection.output.empty() == false)
+    {
+        ssize_t sent = send(fd, connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+
+        if (sent > 0)
+            connection.output.erase(0, sent);
+
+        else if (sent < 0 && errno == EINTR)
+            continue;
+
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        else
+        {
+            closeClient(fd);
+            return;
+        }
+    }
+
+    if (connection.output.size() > MAX_OUTPUT_BUFFERED)
+    {
+        std::cout << "OrderGateway dropping a client that is not reading its responses" << std::endl;
+        closeClient(fd);
+        return;
+    }
+
+    updateInterest(fd, connection);
+}
+
+void OrderGateway::closeClient(int fd)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+void OrderGateway::updateInterest(int fd, Connection& connection)
+{
+    bool wantsWrite = connection.output.empty() == false;
+
+    if (wantsWrite == connection.wantsWrite)
+        return;
+
+    epoll_event event;
+    event.events = wantsWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+
+    connection.wantsWrite = wantsWrite;
+}
+
+#else
+
+bool OrderGateway::start(const std::string& _socketPath)
+{
+    std::cout << "OrderGateway::start the order gateway is only available on Linux" << std::endl;
+    return false;
+}
+
+void OrderGateway::stop()
+{
+
+}
+
+void OrderGateway::publishMarketData(GatewayMessage& update)
+{
+
+}
+
+void OrderGateway::runLoop() {}
+void OrderGateway::acceptClients() {}
+void OrderGateway::readClient(int fd) {}
+void OrderGateway::writeClient(int fd) {}
+void OrderGateway::closeClient(int fd) {}
+void OrderGateway::updateInterest(int fd, Connection& connection) {}
+
+#endif
+
+bool OrderGateway::isRunning()
+{
+    return running;
+}
+
+void OrderGateway::publishWallet(std::map<std::string, double> balances)
+{
+    std::lock_guard<std::mutex> lock{publishMutex};
+    walletSnapshot = balances;
+}
+
+uint64_t OrderGateway::getRequestCount()
+{
+    return requestCount;
+}
+
+void OrderGateway::handleRequest(Connection& connection, GatewayMessage& request)
+{
+    requestCount++;
+
+    GatewayMessage response;
+    response.type = GatewayMessageType::ack;
+    response.requestId = request.requestId;
+
+    if (request.type == GatewayMessageType::submit)
+    {
+        if (request.side > 1 || Wallet::hasValidQuantities(request.price, request.amount) == false || request.product.empty() ||
+            request.timeInForce > static_cast<uint8_t>(TimeInForce::gtt))
+            response.status = GatewayStatus::badRequest;
+
+        else
+        {
+            /** the timestamp is left empty for the matching thread to stamp with the timeframe it lands in */
+            OrderBookType type = request.side == 0 ? OrderBookType::bid : OrderBookType::ask;
+            OrderBookEntry order{request.price, request.amount, "", request.product, type, "simuser"};
+            order.orderId = orderBook.allocateOrderId();
+            order.timeInForce = static_cast<TimeInForce>(request.timeInForce);
+            order.expiresAt = request.expiresAfter;
+
+            response.orderId = order.orderId;
+            response.status = orderQueue.tryPush(OrderCommand{OrderCommandType::submit, order})
+                ? GatewayStatus::accepted
+                : GatewayStatus::queueFull;
+        }
+    }
+
+    /** an amend replaces price and amount, so it has to pass the same checks as a submit */
+    else if (request.type == GatewayMessageType::amend && Wallet::hasValidQuantities(request.price, request.amount) == false)
+        response.status = GatewayStatus::badRequest;
+
+    else if (request.type == GatewayMessageType::cancel || request.type == GatewayMessageType::amend)
+    {
+        OrderCommandType type = request.type == GatewayMessageType::cancel ? OrderCommandType::cancel : OrderCommandType::amend;
+        OrderBookEntry order{request.price, request.amount, "", "", OrderBookType::unknown, "simuser"};
+        order.orderId = request.orderId;
+
+        response.orderId = order.orderId;
+        response.status = orderQueue.tryPush(OrderCommand{type, order})
+            ? GatewayStatus::accepted
+            : GatewayStatus::queueFull;
+    }
+
+    else if (request.type == GatewayMessageType::subscribe)
+        connection.subscriptions.insert(request.product);
+
+    else if (request.type == GatewayMessageType::walletQuery)
+    {
+        std::lock_guard<std::mutex> lock{publishMutex};
+        response.type = GatewayMessageType::walletReport;
+        response.balances = walletSnapshot;
+    }
+
+    else response.status = GatewayStatus::badRequest;
+
+    connection.output += GatewayProtocol::encode(response);
+}
+
+void OrderGateway::deliverMarketData()
+{
+    std::vector<GatewayMessage> updates;
+
+    {
+        std::lock_guard<std::mutex> lock{publishMutex};
+        updates.swap(pendingMarketData);
+    }
+
+    if (updates.empty())
+        return;
+
+    for (GatewayMessage& update : updates)
+    {
+        std::string frame = GatewayProtocol::encode(update);
+
+        for (std::pair<const int, Connection>& connection : connections)
+            if (connection.second.subscriptions.count(update.product) > 0)
+                connection.second.output += frame;
+    }
+
+    /** collect first, since a failed write removes the connection from the map */
+    std::vector<int> fds;
+
+    for (std::pair<const int, Connection>& connection : connections)
+        if (connection.second.output.empty() == false)
+            fds.push_back(connection.first);
+
+    for (int fd : fds)
+        writeClient(fd);
+}
\ No newline at end of file
@@ -0,0 +1,299 @@
+
+#include "../headers/OrderQueryEngine.h"
+#include "../headers/OrderArchive.h"
+#include <algorithm>
+#include <limits>
+#include <iterator>
+
+/** index of the lowest set bit; the word must not be zero */
+static int lowestBit(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+
+    while ((word & 1) == 0)
+    {
+        word >>= 1;
+        bit++;
+    }
+
+    return bit;
+#endif
+}
+
+OrderQueryEngine::OrderQueryEngine()
+{
+
+}
+
+void OrderQueryEngine::build(OrderSpan orders)
+{
+    times.clear();
+    prices.clear();
+    amounts.clear();
+    productIds.clear();
+    sources.clear();
+    products.clear();
+    productIndex.clear();
+    owners.clear();
+    ownerIndex.clear();
+    priceIndexes.clear();
+    sideBitmaps.assign(static_cast<size_t>(OrderBookType::unknown) + 1, Bitmap{});
+    ownerBitmaps.clear();
+
+    std::vector<std::pair<int64_t, const OrderBookEntry*>> rows;
+    rows.reserve(orders.size());
+
+    /** rows of the same timestamp come in runs, so each distinct timestamp is parsed once */
+    const std::string* lastTimestamp = nullptr;
+    int64_t lastTime = 0;
+
+    for (const OrderBookEntry& entry : orders)
+    {
+        if (lastTimestamp == nullptr || entry.timestamp != *lastTimestamp)
+        {
+            lastTime = OrderArchive::parseTimestamp(entry.timestamp);
+            lastTimestamp = &entry.timestamp;
+        }
+
+        rows.push_back(std::make_pair(lastTime, &entry));
+    }
+
+    /** the dataset is already in time order, and only user orders need sorting */
+    auto byTime = [](const std::pair<int64_t, const OrderBookEntry*>& a, const std::pair<int64_t, const OrderBookEntry*>& b) { return a.first < b.first; };
+
+    if (std::is_sorted(rows.begin(), rows.end(), byTime) == false)
+        std::stable_sort(rows.begin(), rows.end(), byTime);
+
+    times.reserve(rows.size());
+    prices.reserve(rows.size());
+    amounts.reserve(rows.size());
+    productIds.reserve(rows.size());
+    sources.reserve(rows.size());
+
+    for (uint32_t row = 0; row < rows.size(); row++)
+    {
+        const OrderBookEntry& entry = *rows[row].second;
+        uint32_t productId = intern(entry.product, products, productIndex);
+        uint32_t ownerId = intern(entry.username, owners, ownerIndex);
+
+        times.push_back(rows[row].first);
+        prices.push_back(entry.price);
+        amounts.push_back(entry.amount);
+        productIds.push_back(productId);
+        sources.push_back(&entry);
+
+        if (productId == priceIndexes.size())
+            priceIndexes.push_back(PriceIndex{});
+
+        if (ownerId == ownerBitmaps.size())
+            ownerBitmaps.push_back(Bitmap{});
+
+        priceIndexes[productId].rows.push_back(row);
+        setBit(sideBitmaps[static_cast<size_t>(entry.orderType)], row);
+        setBit(ownerBitmaps[ownerId], row);
+    }
+
+    /** every bitmap covers every row, so intersections never run off the end of one */
+    size_t words = (rows.size() + 63) / 64;
+
+    for (Bitmap& bitmap : sideBitmaps)
+        bitmap.resize(words, 0);
+
+    for (Bitmap& bitmap : ownerBitmaps)
+        bitmap.resize(words, 0);
+
+    for (PriceIndex& index : priceIndexes)
+    {
+        std::stable_sort(index.rows.begin(), index.rows.end(),
+            [this](uint32_t a, uint32_t b) { return prices[a] < prices[b]; });
+
+        index.prices.reserve(index.rows.size());
+
+        for (uint32_t row : index.rows)
+            index.prices.push_back(prices[row]);
+    }
+}
+
+OrderQueryResult OrderQueryEngine::run(const OrderQuery& query)
+{
+    OrderQueryResult result;
+
+    /** a product or owner that was never seen matches nothing */
+    std::vector<uint32_t> queryProducts;
+
+    if (query.product != "")
+    {
+        std::unordered_map<std::string, uint32_t>::iterator found = productIndex.find(query.product);
+
+        if (found == productIndex.end())
+            return result;
+
+        queryProducts.push_back(found->second);
+    }
+
+    else for (uint32_t productId = 0; productId < products.size(); productId++)
+        queryProducts.push_back(productId);
+
+    const Bitmap* ownerBitmap = nullptr;
+
+    if (query.owner != "")
+    {
+        std::unordered_map<std::string, uint32_t>::iterator found = ownerIndex.find(query.owner);
+
+        if (found == ownerIndex.end())
+            return result;
+
+        ownerBitmap = &ownerBitmaps[found->second];
+    }
+
+    const Bitmap* sideBitmap = nullptr;
+
+    if (query.type != OrderBookType::unknown)
+        sideBitmap = &sideBitmaps[static_cast<size_t>(query.type)];
+
+    /** rows are in time order, so the time range is a contiguous run of them */
+    int64_t startTime = query.startTime != "" ? OrderArchive::parseTimestamp(query.startTime) : std::numeric_limits<int64_t>::min();
+    int64_t endTime = query.endTime != "" ? OrderArchive::parseTimestamp(query.endTime) : std::numeric_limits<int64_t>::max();
+
+    uint32_t first = std::lower_bound(times.begin(), times.end(), startTime) - times.begin();
+    uint32_t last = std::upper_bound(times.begin(), times.end(), endTime) - times.begin();
+
+    if (first >= last)
+        return result;
+
+    double minPrice = query.minPrice > 0 ? query.minPrice : -std::numeric_limits<double>::infinity();
+    double maxPrice = query.maxPrice > 0 ? query.maxPrice : std::numeric_limits<double>::infinity();
+
+    /** the price range of each product is also a contiguous run, in its price index */
+    std::vector<std::pair<size_t, size_t>> priceRanges;
+    size_t priceRows = 0;
+
+    for (uint32_t productId : queryProducts)
+    {
+        PriceIndex& index = priceIndexes[productId];
+        size_t low = std::lower_bound(index.prices.begin(), index.prices.end(), minPrice) - index.prices.begin();
+        size_t high = std::upper_bound(index.prices.begin(), index.prices.end(), maxPrice) - index.prices.begin();
+
+        priceRanges.push_back(std::make_pair(low, high));
+        priceRows += high - low;
+    }
+
+    /** seed the candidates from whichever range is narrower, checking the other range row by row */
+    size_t firstWord = first / 64;
+    size_t lastWord = (last + 63) / 64;
+    Bitmap candidates(lastWord - firstWord, 0);
+
+    if (priceRows < last - first)
+    {
+        for (size_t i = 0; i < queryProducts.size(); i++)
+        {
+            PriceIndex& index = priceIndexes[queryProducts[i]];
+
+            for (size_t position = priceRanges[i].first; position < priceRanges[i].second; position++)
+            {
+                uint32_t row = index.rows[position];
+
+                if (row >= first && row < last)
+                    candidates[row / 64 - firstWord] |= uint64_t{1} << (row % 64);
+            }
+        }
+    }
+
+    else
+    {
+        bool anyProduct = query.product == "";
+        uint32_t productId = anyProduct ? 0 : queryProducts[0];
+
+        for (uint32_t row = first; row < last; row++)
+        {
+            if ((anyProduct || productIds[row] == productId) && prices[row] >= minPrice && prices[row] <= maxPrice)
+                candidates[row / 64 - firstWord] |= uint64_t{1} << (row % 64);
+        }
+    }
+
+    /** intersect with the side and owner bitmaps, then aggregate off the columns */
+    for (size_t word = 0; word < candidates.size(); word++)
+    {
+        uint64_t bits = candidates[word];
+
+        if (sideBitmap != nullptr)
+            bits &= (*sideBitmap)[firstWord + word];
+
+        if (ownerBitmap != nullptr)
+            bits &= (*ownerBitmap)[firstWord + word];
+
+        while (bits != 0)
+        {
+            uint32_t row = (firstWord + word) * 64 + lowestBit(bits);
+            bits &= bits - 1;
+
+            if (result.count == 0 || prices[row] < result.minPrice)
+                result.minPrice = prices[row];
+
+            if (result.count == 0 || prices[row] > result.maxPrice)
+                result.maxPrice = prices[row];
+
+            result.count++;
+            result.totalAmount += amounts[row];
+            result.totalNotional += amounts[row] * prices[row];
+
+            if (result.rows.size() < query.rowLimit)
+                result.rows.push_back(*sources[row]);
+        }
+    }
+
+    return result;
+}
+
+OrderQueryResult OrderQueryEngine::combine(OrderQueryResult& first, OrderQueryResult& second, size_t rowLimit)
+{
+    if (first.count == 0)
+        return second;
+
+    if (second.count == 0)
+        return first;
+
+    OrderQueryResult result;
+    result.count = first.count + second.count;
+    result.totalAmount = first.totalAmount + second.totalAmount;
+    result.totalNotional = first.totalNotional + second.totalNotional;
+    result.minPrice = std::min(first.minPrice, second.minPrice);
+    result.maxPrice = std::max(first.maxPrice, second.maxPrice);
+
+    /** both row lists are in time order, and the earliest rowLimit of the two are the earliest overall */
+    std::merge(first.rows.begin(), first.rows.end(), second.rows.begin(), second.rows.end(),
+        std::back_inserter(result.rows), OrderBookEntry::compareByTimestamp);
+
+    if (result.rows.size() > rowLimit)
+        result.rows.erase(result.rows.begin() + rowLimit, result.rows.end());
+
+    return result;
+}
+
+uint32_t OrderQueryEngine::intern(
+    const std::string& value,
+    std::vector<std::string>& names,
+    std::unordered_map<std::string, uint32_t>& ids
+)
+{
+    std::unordered_map<std::string, uint32_t>::iterator found = ids.find(value);
+
+    if (found != ids.end())
+        return found->second;
+
+    ids[value] = names.size();
+    names.push_back(value);
+
+    return names.size() - 1;
+}
+
+void OrderQueryEngine::setBit(Bitmap& bitmap, uint32_t row)
+{
+    if (bitmap.size() <= row / 64)
+        bitmap.resize(row / 64 + 1, 0);
+
+    bitmap[row / 64] |= uint64_t{1} << (row % 64);
+}
\ No newline at end of file
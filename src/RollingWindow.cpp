@@ -0,0 +1,105 @@
+
+#include "../headers/RollingWindow.h"
+#include <exception>
+
+RollingWindow::RollingWindow(unsigned int length)
+:   values(length > 0 ? length : 1, 0),
+    next(0),
+    count(0),
+    sum(0),
+    sumSquares(0)
+{
+
+}
+
+void RollingWindow::push(double value)
+{
+    /** take the value falling out of the window off the running totals */
+    if (isFull())
+    {
+        sum -= values[next];
+        sumSquares -= values[next] * values[next];
+    }
+
+    else count++;
+
+    values[next] = value;
+    sum += value;
+    sumSquares += value * value;
+
+    next = (next + 1) % values.size();
+}
+
+bool RollingWindow::isFull()
+{
+    return count == values.size();
+}
+
+unsigned int RollingWindow::getCount()
+{
+    return count;
+}
+
+unsigned int RollingWindow::getLength()
+{
+    return values.size();
+}
+
+double RollingWindow::getSum()
+{
+    return sum;
+}
+
+double RollingWindow::getMean()
+{
+    if (count == 0)
+        return 0;
+
+    return sum / count;
+}
+
+double RollingWindow::getVariance()
+{
+    if (count == 0)
+        return 0;
+
+    double mean = getMean();
+    double variance = sumSquares / count - mean * mean;
+
+    /** the running totals can leave a tiny negative through rounding */
+    return variance > 0 ? variance : 0;
+}
+
+void RollingWindow::save(BinaryWriter& writer)
+{
+    writer.writeUInt32(values.size());
+    writer.writeUInt32(next);
+    writer.writeUInt32(count);
+
+    for (double value : values)
+        writer.writeDouble(value);
+}
+
+void RollingWindow::load(BinaryReader& reader)
+{
+    values.assign(reader.readUInt32(), 0);
+    next = reader.readUInt32();
+    count = reader.readUInt32();
+
+    if (values.empty() || next >= values.size() || count > values.size())
+        throw std::exception{};
+
+    for (double& value : values)
+        value = reader.readDouble();
+
+    /** the totals are rebuilt rather than saved, which also sheds any rounding drift */
+    sum = 0;
+    sumSquares = 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        double value = values[(next + values.size() - 1 - i) % values.size()];
+        sum += value;
+        sumSquares += value * value;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+
+#include "../headers/TimerWheel.h"
+
+TimerWheel::TimerWheel()
+:   currentTick(0)
+{
+
+}
+
+void TimerWheel::schedule(uint64_t id, uint64_t expiry)
+{
+    place(Timer{id, expiry});
+}
+
+void TimerWheel::advance(uint64_t now, std::vector<uint64_t>& expired)
+{
+    while (currentTick < now)
+    {
+        currentTick++;
+
+        /** when the low bits wrap, bring the next slot of each level above down, highest first */
+        for (unsigned int level = levelCount - 1; level > 0; level--)
+        {
+            uint64_t lowerMask = (uint64_t(1) << (slotBits * level)) - 1;
+
+            if ((currentTick & lowerMask) == 0)
+                cascade(slots[level][(currentTick >> (slotBits * level)) & (slotsPerLevel - 1)], expired);
+        }
+
+        /** the top level has wrapped too; see if any far-off timers are now in reach */
+        if ((currentTick & ((uint64_t(1) << (slotBits * levelCount)) - 1)) == 0)
+            cascade(overflow, expired);
+
+        std::vector<Timer>& slot = slots[0][currentTick & (slotsPerLevel - 1)];
+        std::vector<Timer> pending;
+        pending.swap(slot);
+
+        for (Timer& timer : pending)
+        {
+            if (timer.expiry <= currentTick)
+                expired.push_back(timer.id);
+
+            else place(timer);
+        }
+    }
+}
+
+void TimerWheel::reset(uint64_t tick)
+{
+    for (unsigned int level = 0; level < levelCount; level++)
+        for (unsigned int slot = 0; slot < slotsPerLevel; slot++)
+            slots[level][slot].clear();
+
+    overflow.clear();
+    currentTick = tick;
+}
+
+void TimerWheel::place(Timer timer)
+{
+    /** anything already due goes in the very next tick's slot */
+    uint64_t expiry = timer.expiry > currentTick ? timer.expiry : currentTick + 1;
+    uint64_t delta = expiry - currentTick;
+
+    for (unsigned int level = 0; level < levelCount; level++)
+    {
+        if (delta < (uint64_t(1) << (slotBits * (level + 1))))
+        {
+            unsigned int slot = (expiry >> (slotBits * level)) & (slotsPerLevel - 1);
+            slots[level][slot].push_back(timer);
+            return;
+        }
+    }
+
+    overflow.push_back(timer);
+}
+
+void TimerWheel::cascade(std::vector<Timer>& source, std::vector<uint64_t>& expired)
+{
+    std::vector<Timer> pending;
+    pending.swap(source);
+
+    /** a timer brought down on its own tick is due now; placing it would push it to the next one */
+    for (Timer& timer : pending)
+    {
+        if (timer.expiry <= currentTick)
+            expired.push_back(timer.id);
+
+        else place(timer);
+    }
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 
 #include "../headers/Wallet.h"
 #include "../headers/CSVReader.h"
+#include <algorithm>
+#include <cmath>
 
 Wallet::Wallet()
 {
@@ -8,7 +10,7 @@ Wallet::Wallet()
 }
 
 
-void Wallet::insertCurrency(std::string type, double amount)
+void Wallet::insertCurrency(const std::string& type, double amount)
 {
     double balance;
 
@@ -26,7 +28,7 @@ void Wallet::insertCurrency(std::string type, double amount)
     currencies[type] = balance;
 }
 
-bool Wallet::removeCurrency(std::string type, double amount)
+bool Wallet::removeCurrency(const std::string& type, double amount)
 {
     if (amount < 0)
         return false;
@@ -46,15 +48,16 @@ bool Wallet::removeCurrency(std::string type, double amount)
     else return false;
 }
 
-bool Wallet::containsCurrency(std::string type, double amount)
+bool Wallet::containsCurrency(const std::string& type, double amount)
 {
     if (currencies.count(type) == 0)
         return false;
 
-    else return currencies[type] >= amount;
+    /** funds reserved for resting orders are not available */
+    else return currencies[type] - reserved[type] >= amount;
 }
 
-bool Wallet::canFulfillOrder(OrderBookEntry order)
+bool Wallet::canFulfillOrder(const OrderBookEntry& order)
 {
     std::vector<std::string> currencies = CSVReader::tokenise(order.product, '/');
 
@@ -81,10 +84,20 @@ bool Wallet::canFulfillOrder(OrderBookEntry order)
     return false;
 }
 
-void Wallet::processSale(OrderBookEntry sale)
+void Wallet::processSale(const OrderBookEntry& sale)
 {
     std::vector<std::string> saleCurrencies = CSVReader::tokenise(sale.product, '/');
 
+    /** the filled part of the order no longer needs its funds held back */
+    std::map<uint64_t, Reservation>::iterator reservation = reservations.find(sale.orderId);
+
+    if (reservation != reservations.end())
+    {
+        double release = std::min(reservation->second.remaining, sale.amount * reservation->second.perUnit);
+        reservation->second.remaining -= release;
+        reserved[reservation->second.currency] -= release;
+    }
+
     /** ask */
     if (sale.orderType == OrderBookType::asksale)
     {
@@ -114,6 +127,88 @@ void Wallet::processSale(OrderBookEntry sale)
     }
 }
 
+bool Wallet::reserveOrder(OrderBookEntry& order)
+{
+    std::string currency;
+    double amount, perUnit;
+
+    if (hasValidQuantities(order.price, order.amount) == false)
+        return false;
+
+    if (getOrderCost(order, currency, amount, perUnit) == false || containsCurrency(currency, amount) == false)
+        return false;
+
+    reservations[order.orderId] = Reservation{currency, perUnit, amount};
+    reserved[currency] += amount;
+    return true;
+}
+
+bool Wallet::hasValidQuantities(double price, double amount)
+{
+    /** NaN fails every comparison, so it has to be ruled out apart from the sign */
+    return std::isfinite(price) && std::isfinite(amount) && price > 0 && amount > 0;
+}
+
+void Wallet::releaseOrder(uint64_t orderId)
+{
+    std::map<uint64_t, Reservation>::iterator reservation = reservations.find(orderId);
+
+    if (reservation == reservations.end())
+        return;
+
+    double& held = reserved[reservation->second.currency];
+    held -= reservation->second.remaining;
+
+    /** don't let rounding leave a sliver of negative reservation behind */
+    if (held < 0)
+        held = 0;
+
+    reservations.erase(reservation);
+}
+
+void Wallet::clearReservations()
+{
+    reservations.clear();
+    reserved.clear();
+}
+
+bool Wallet::getOrderCost(const OrderBookEntry& order, std::string& currency, double& amount, double& perUnit)
+{
+    std::vector<std::string> currencies = CSVReader::tokenise(order.product, '/');
+
+    if (currencies.size() != 2)
+        return false;
+
+    /** an ask delivers the amount of the first currency */
+    if (order.orderType == OrderBookType::ask)
+    {
+        currency = currencies[0];
+        perUnit = 1;
+    }
+
+    /** a bid pays the amount times the price in the second currency */
+    else if (order.orderType == OrderBookType::bid)
+    {
+        currency = currencies[1];
+        perUnit = order.price;
+    }
+
+    else return false;
+
+    amount = order.amount * perUnit;
+    return true;
+}
+
+std::map<std::string, double> Wallet::getBalances()
+{
+    return currencies;
+}
+
+void Wallet::setBalances(std::map<std::string, double> balances)
+{
+    currencies = balances;
+}
+
 std::string Wallet::toString()
 {
     std::string walletStr;
@@ -123,7 +218,12 @@ std::string Wallet::toString()
         std::string currency = pair.first;
         double amount = pair.second;
 
-        walletStr += currency + ": " + std::to_string(amount) + "\n";
+        walletStr += currency + ": " + std::to_string(amount);
+
+        if (reserved[currency] > 0)
+            walletStr += " (reserved " + std::to_string(reserved[currency]) + ")";
+
+        walletStr += "\n";
     }
 
     return walletStr;
@@ -5,11 +5,40 @@
 #include "../headers/Wallet.h"
 
 /*  To compile, cd to src and then: 
-    g++ --std=c++11 main.cpp *.cpp
+    g++ --std=c++17 -pthread *.cpp
+
+    To replay a recorded run, optionally stopping after a given event:
+    ./a.out --replay merkel.eventlog [sequence]
+
+    Each start moves the last log aside first, so the run before it is merkel.eventlog.1
 */
 
-int main()
+int main(int argc, char* argv[])
 {
+    if (argc >= 2 && std::string{argv[1]} == "--replay")
+    {
+        uint64_t lastSequence = 0;
+
+        try
+        {
+            if (argc < 3 || argc > 4)
+                throw std::exception{};
+
+            if (argc == 4)
+                lastSequence = CSVReader::stringToUnsigned(argv[3]);
+        }
+
+        catch(const std::exception& e)
+        {
+            std::cout << "Usage: " << argv[0] << " --replay <event log> [sequence]" << std::endl;
+            return 1;
+        }
+
+        MerkelMain app{false};
+        app.replay(argv[2], lastSequence);
+        return 0;
+    }
+
     MerkelMain app{};
     app.init();
     
@@ -0,0 +1,132 @@
+
+#include "../headers/GatewayProtocol.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*  Local load generator for the order gateway. Start the gateway from the menu (option 10),
+    then from the tools folder:
+    g++ --std=c++17 -O2 LoadGenerator.cpp ../src/GatewayProtocol.cpp ../src/BinaryIO.cpp -o loadgen
+    ./loadgen ../src/merkel.sock 100000 64
+
+    Arguments are the socket path, the number of orders to submit and how many requests
+    may be in flight at once. Prints round-trip latency percentiles and orders/sec.
+*/
+
+typedef std::chrono::steady_clock Clock;
+
+int main(int argc, char* argv[])
+{
+    std::string socketPath = argc > 1 ? argv[1] : "merkel.sock";
+    uint32_t orderCount = argc > 2 ? std::stoul(argv[2]) : 100000;
+    uint32_t window = argc > 3 ? std::stoul(argv[3]) : 64;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        std::cout << "LoadGenerator could not connect to " << socketPath << std::endl;
+        return 1;
+    }
+
+    std::vector<Clock::time_point> sentAt(orderCount);
+    std::vector<double> latencies;
+    latencies.reserve(orderCount);
+
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    uint32_t accepted = 0;
+    uint32_t queueFull = 0;
+    uint32_t badRequests = 0;
+
+    std::string input;
+    std::string payload;
+    char buffer[64 * 1024];
+
+    Clock::time_point start = Clock::now();
+
+    while (received < orderCount)
+    {
+        /** top the pipeline up to the window and send the whole batch in one write */
+        std::string batch;
+
+        while (sent < orderCount && sent - received < window)
+        {
+            GatewayMessage submit;
+            submit.type = GatewayMessageType::submit;
+            submit.requestId = sent;
+            submit.product = "ETH/BTC";
+            submit.side = sent % 2;
+            submit.price = submit.side == 0 ? 0.0001 : 1000;
+            submit.amount = 0.0001;
+
+            batch += GatewayProtocol::encode(submit);
+            sentAt[sent] = Clock::now();
+            sent++;
+        }
+
+        if (batch.empty() == false && send(fd, batch.data(), batch.size(), 0) != static_cast<ssize_t>(batch.size()))
+        {
+            std::cout << "LoadGenerator lost the connection while sending" << std::endl;
+            return 1;
+        }
+
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+
+        if (count <= 0)
+        {
+            std::cout << "LoadGenerator lost the connection while reading" << std::endl;
+            return 1;
+        }
+
+        input.append(buffer, count);
+        size_t offset = 0;
+
+        while (GatewayProtocol::extractFrame(input, offset, payload))
+        {
+            GatewayMessage response = GatewayProtocol::decode(payload);
+
+            /** market data isn't subscribed to, but skip anything that isn't an order ack */
+            if (response.type != GatewayMessageType::ack || response.requestId >= orderCount)
+                continue;
+
+            std::chrono::duration<double, std::micro> latency = Clock::now() - sentAt[response.requestId];
+            latencies.push_back(latency.count());
+            received++;
+
+            if (response.status == GatewayStatus::accepted)
+                accepted++;
+
+            else if (response.status == GatewayStatus::queueFull)
+                queueFull++;
+
+            else badRequests++;
+        }
+
+        input.erase(0, offset);
+    }
+
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    close(fd);
+
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "Orders sent: " << orderCount << " in " << elapsed.count() << "s" << std::endl;
+    std::cout << "Orders/sec: " << orderCount / elapsed.count() << std::endl;
+    std::cout << "Accepted: " << accepted << " Queue full: " << queueFull << " Bad: " << badRequests << std::endl;
+    std::cout << "Round trip p50: " << latencies[latencies.size() / 2] << "us"
+              << " p99: " << latencies[latencies.size() * 99 / 100] << "us"
+              << " max: " << latencies.back() << "us" << std::endl;
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,406 @@
+
+#include "../headers/TimerWheel.h"
+#include "../headers/OrderBook.h"
+#include "../headers/OrderQueue.h"
+#include "../headers/OrderArchive.h"
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <thread>
+
+/*  Regression checks for edge cases that once slipped through. From the tools folder:
+    g++ --std=c++17 -O2 RegressionChecks.cpp ../src/OrderBook.cpp ../src/OrderBookEntry.cpp ../src/CSVReader.cpp \
+        ../src/DepthLadder.cpp ../src/TimerWheel.cpp ../src/OrderArchive.cpp ../src/OrderQueryEngine.cpp \
+        ../src/BinaryIO.cpp -pthread -o regressions
+    ./regressions
+
+    Prints every failed check and exits with 1 if there was any.
+*/
+
+static int failures = 0;
+
+static void check(bool passed, std::string description)
+{
+    if (passed == false)
+    {
+        std::cout << "FAILED: " << description << std::endl;
+        failures++;
+    }
+}
+
+/** a timer must fire on exactly its expiry tick, including expiries that cascade down from a
+ *  higher level on the tick they are due, such as multiples of 64 */
+static void checkTimerBoundaries()
+{
+    std::vector<uint64_t> starts{0, 1, 63, 64, 4095, 4096, 262143};
+    std::vector<uint64_t> offsets{1, 2, 63, 64, 65, 127, 128, 129, 4095, 4096, 4097, 262144, 16777216, 16777217};
+
+    for (uint64_t start : starts)
+    {
+        for (uint64_t offset : offsets)
+        {
+            TimerWheel wheel;
+            wheel.reset(start);
+
+            uint64_t expiry = start + offset;
+            wheel.schedule(1, expiry);
+
+            std::vector<uint64_t> fired;
+            uint64_t firedAt = 0;
+            uint64_t tick = start + 1;
+
+            /** far-off timers jump most of the way in one advance, then everything steps a tick at a time */
+            if (offset > 100000)
+            {
+                tick = expiry - 70000;
+                wheel.advance(tick - 1, fired);
+            }
+
+            for (; tick <= expiry + 1 && firedAt == 0; tick++)
+            {
+                wheel.advance(tick, fired);
+
+                if (fired.empty() == false)
+                    firedAt = tick;
+            }
+
+            check(firedAt == expiry,
+                "timer from " + std::to_string(start) + " due at " + std::to_string(expiry) +
+                " fired at " + std::to_string(firedAt));
+        }
+    }
+}
+
+/** add a user order to the book with a fresh id */
+static uint64_t placeUserOrder(OrderBook& book, OrderBookEntry order, TimeInForce timeInForce)
+{
+    order.orderId = book.allocateOrderId();
+    order.timeInForce = timeInForce;
+    book.insertOrder(order);
+
+    return order.orderId;
+}
+
+/** a fill-or-kill order must fill completely after every order ranked ahead of it, or not at all */
+static void checkFillOrKillPriority()
+{
+    std::string timestamp = "2020/06/01 11:57:30.328127";
+    std::string product = "ETH/BTC";
+
+    {
+        /** the dataset bid outranks the user's and takes half the only ask, so the user can't be filled */
+        OrderBook book{""};
+        OrderBookEntry ask{1.0, 1, timestamp, product, OrderBookType::ask};
+        OrderBookEntry bid{2.0, 0.5, timestamp, product, OrderBookType::bid};
+        book.insertOrder(ask);
+        book.insertOrder(bid);
+
+        uint64_t orderId = placeUserOrder(book, OrderBookEntry{1.5, 1, timestamp, product, OrderBookType::bid, "simuser"}, TimeInForce::fok);
+        std::vector<OrderBookEntry> sales = book.matchAsksToBids(product, timestamp);
+
+        for (OrderBookEntry& sale : sales)
+            check(sale.orderId != orderId, "fill-or-kill bid behind a better dataset bid was partly filled");
+
+        check(book.findUserOrder(orderId) == nullptr, "unfilled fill-or-kill bid stayed in the book");
+        check(book.takeClosedOrders().size() == 1, "unfilled fill-or-kill bid was not closed");
+        check(sales.size() == 1 && sales[0].amount == 0.5, "dataset fill was lost when the fill-or-kill bid was killed");
+    }
+
+    {
+        /** with enough volume behind the dataset bid the same order fills completely */
+        OrderBook book{""};
+        OrderBookEntry ask{1.0, 1.5, timestamp, product, OrderBookType::ask};
+        OrderBookEntry bid{2.0, 0.5, timestamp, product, OrderBookType::bid};
+        book.insertOrder(ask);
+        book.insertOrder(bid);
+
+        uint64_t orderId = placeUserOrder(book, OrderBookEntry{1.5, 1, timestamp, product, OrderBookType::bid, "simuser"}, TimeInForce::fok);
+        std::vector<OrderBookEntry> sales = book.matchAsksToBids(product, timestamp);
+        double filled = 0;
+
+        for (OrderBookEntry& sale : sales)
+            if (sale.orderId == orderId)
+                filled += sale.amount;
+
+        check(filled == 1, "fillable fill-or-kill bid was not filled completely");
+    }
+}
+
+/** several producers racing one consumer must lose nothing, duplicate nothing and keep each producer's order;
+ *  a full queue must turn pushes away until the consumer frees a slot */
+static void checkOrderQueue()
+{
+    {
+        OrderQueue<uint64_t> queue{6};
+        check(queue.getCapacity() == 8, "queue capacity was not rounded up to a power of two");
+
+        for (uint64_t i = 0; i < 8; i++)
+            check(queue.tryPush(i), "queue turned a push away before it was full");
+
+        check(queue.tryPush(8) == false, "full queue accepted a push");
+        check(queue.getRejectedCount() == 1 && queue.getPushedCount() == 8, "queue counted pushes wrong");
+
+        uint64_t item = 0;
+        check(queue.tryPop(item) && item == 0, "queue did not pop its oldest item");
+        check(queue.tryPush(8), "queue turned a push away after a slot was freed");
+    }
+
+    const uint64_t producerCount = 4;
+    const uint64_t itemsPerProducer = 200000;
+
+    /** a small queue, so producers keep running into it being full */
+    OrderQueue<uint64_t> queue{64};
+    std::vector<std::thread> producers;
+
+    for (uint64_t producer = 0; producer < producerCount; producer++)
+    {
+        producers.push_back(std::thread{[&queue, producer, itemsPerProducer]()
+        {
+            for (uint64_t i = 0; i < itemsPerProducer; i++)
+                while (queue.tryPush(producer << 32 | i) == false)
+                    std::this_thread::yield();
+        }});
+    }
+
+    /** each producer's items must arrive as 0, 1, 2, ... with nothing missing or repeated */
+    std::vector<uint64_t> expected(producerCount, 0);
+    std::vector<uint64_t> drained;
+    uint64_t received = 0;
+    bool ordered = true;
+
+    while (received < producerCount * itemsPerProducer)
+    {
+        drained.clear();
+
+        if (queue.drain(drained, 256) == 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (uint64_t item : drained)
+        {
+            uint64_t producer = item >> 32;
+
+            if (producer >= producerCount || (item & 0xFFFFFFFF) != expected[producer])
+                ordered = false;
+
+            else expected[producer]++;
+
+            received++;
+        }
+    }
+
+    for (std::thread& producer : producers)
+        producer.join();
+
+    uint64_t leftover = 0;
+    check(ordered, "queue lost, repeated or reordered a producer's items");
+    check(queue.tryPop(leftover) == false, "queue held more items than were pushed");
+    check(queue.getPushedCount() == producerCount * itemsPerProducer, "queue miscounted concurrent pushes");
+}
+
+/** the fields an archive keeps, so an order read back can be compared with the one written */
+static bool sameArchivedOrder(const OrderBookEntry& a, const OrderBookEntry& b)
+{
+    return a.timestamp == b.timestamp && a.product == b.product && a.orderType == b.orderType &&
+        a.price == b.price && a.amount == b.amount;
+}
+
+/** what a query should return, worked out by checking every order against it */
+static std::vector<OrderBookEntry> scanArchiveQuery(std::vector<OrderBookEntry>& orders, const ArchiveQuery& query)
+{
+    std::vector<OrderBookEntry> matches;
+
+    for (OrderBookEntry& order : orders)
+    {
+        if ((query.product.empty() || order.product == query.product) &&
+            (query.startTime.empty() || order.timestamp >= query.startTime) &&
+            (query.endTime.empty() || order.timestamp <= query.endTime) &&
+            (query.minPrice == 0 || order.price >= query.minPrice) &&
+            (query.maxPrice == 0 || order.price <= query.maxPrice))
+            matches.push_back(order);
+    }
+
+    return matches;
+}
+
+/** an archive must give back exactly the orders written to it, in time order, and a product
+ *  query must only read that product's chunks */
+static void checkArchiveRoundTrip()
+{
+    std::string filename = "regressions.mrka";
+    std::vector<std::string> products{"BTC/USDT", "DOGE/BTC", "ETH/BTC"};
+    std::vector<OrderBookEntry> orders;
+    int64_t start = OrderArchive::parseTimestamp("2020/03/17 17:01:24.884492");
+
+    /** several chunks per product, interleaved in time, with prices and amounts at the 1e-8 the csv data has */
+    for (uint64_t i = 0; i < 4 * OrderArchive::chunkRows + 500; i++)
+    {
+        double price = (2000000 + (i * 7919) % 1000000) / 1e8;
+        double amount = (1 + (i * 104729) % 5000000000) / 1e8;
+        OrderBookType side = i % 3 == 0 ? OrderBookType::bid : OrderBookType::ask;
+
+        orders.push_back(OrderBookEntry{price, amount, OrderArchive::formatTimestamp(start + i * 1500), products[i % products.size()], side});
+    }
+
+    check(OrderArchive::formatTimestamp(start) == "2020/03/17 17:01:24.884492", "archive timestamps don't read back as written");
+
+    OrderArchive::write(filename, orders);
+
+    std::vector<ArchiveQuery> queries(4);
+    queries[1].product = "ETH/BTC";
+    queries[2].startTime = orders[1000].timestamp;
+    queries[2].endTime = orders[2500].timestamp;
+    queries[3].product = "DOGE/BTC";
+    queries[3].startTime = orders[700].timestamp;
+    queries[3].minPrice = 0.0225;
+    queries[3].maxPrice = 0.0275;
+
+    for (size_t q = 0; q < queries.size(); q++)
+    {
+        ArchiveScanStats stats;
+        std::vector<OrderBookEntry> found = OrderArchive::query(filename, queries[q], stats);
+        std::vector<OrderBookEntry> expected = scanArchiveQuery(orders, queries[q]);
+        bool same = found.size() == expected.size();
+
+        for (size_t i = 0; same && i < found.size(); i++)
+            same = sameArchivedOrder(found[i], expected[i]);
+
+        check(same, "archive query " + std::to_string(q) + " returned " + std::to_string(found.size()) +
+            " orders where a scan finds " + std::to_string(expected.size()));
+
+        if (queries[q].product.empty() == false)
+            check(stats.chunksRead < stats.chunksTotal, "archive query for one product read every chunk");
+    }
+
+    std::remove(filename.c_str());
+}
+
+/** answer a history query by looking at every order, the way the indexes must agree with */
+static OrderQueryResult scanOrderQuery(std::vector<OrderBookEntry>& orders, const OrderQuery& query)
+{
+    OrderQueryResult result;
+
+    for (OrderBookEntry& order : orders)
+    {
+        if ((query.product.empty() == false && order.product != query.product) ||
+            (query.type != OrderBookType::unknown && order.orderType != query.type) ||
+            (query.owner.empty() == false && order.username != query.owner) ||
+            (query.startTime.empty() == false && order.timestamp < query.startTime) ||
+            (query.endTime.empty() == false && order.timestamp > query.endTime) ||
+            (query.minPrice != 0 && order.price < query.minPrice) ||
+            (query.maxPrice != 0 && order.price > query.maxPrice))
+            continue;
+
+        if (result.count == 0 || order.price < result.minPrice)
+            result.minPrice = order.price;
+
+        if (result.count == 0 || order.price > result.maxPrice)
+            result.maxPrice = order.price;
+
+        result.count++;
+        result.totalAmount += order.amount;
+        result.totalNotional += order.amount * order.price;
+
+        if (result.rows.size() < query.rowLimit)
+            result.rows.push_back(order);
+    }
+
+    return result;
+}
+
+/** sums may be added up in a different order, so they only need to agree to rounding */
+static bool closeTo(double a, double b)
+{
+    return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b));
+}
+
+/** an indexed history query must give the same answer as checking every order, over the dataset,
+ *  over user orders, and over user orders changed after the last query */
+static void checkOrderQueries()
+{
+    std::vector<std::string> products{"BTC/USDT", "ETH/BTC"};
+    std::vector<std::string> owners{"simuser", "agent"};
+    int64_t start = OrderArchive::parseTimestamp("2020/03/17 17:01:24.884492");
+
+    OrderBook book{""};
+    std::vector<OrderBookEntry> dataset;
+
+    /** every order has its own timestamp, so time order is the same however ties are broken */
+    for (uint64_t i = 0; i < 3000; i++)
+    {
+        double price = (2000000 + (i * 7919) % 1000000) / 1e8;
+        OrderBookType side = i % 3 == 0 ? OrderBookType::bid : OrderBookType::ask;
+        dataset.push_back(OrderBookEntry{price, 1 + i % 17 / 4.0, OrderArchive::formatTimestamp(start + i * 1000), products[i % 2], side});
+    }
+
+    book.insertOrders(dataset);
+
+    /** the same orders in time order, with the user orders merged in as they are added */
+    std::vector<OrderBookEntry> orders = dataset;
+
+    std::vector<OrderQuery> queries(6);
+    queries[1].product = "ETH/BTC";
+    queries[1].rowLimit = 5;
+    queries[2].type = OrderBookType::bid;
+    queries[2].startTime = dataset[400].timestamp;
+    queries[2].endTime = dataset[2100].timestamp;
+    queries[2].rowLimit = 3;
+    queries[3].owner = "simuser";
+    queries[3].rowLimit = 100;
+    queries[4].product = "BTC/USDT";
+    queries[4].minPrice = 0.0225;
+    queries[4].maxPrice = 0.0275;
+    queries[4].owner = "dataset";
+    queries[5].startTime = dataset[1500].timestamp;
+    queries[5].minPrice = 0.025;
+    queries[5].rowLimit = 10;
+
+    for (int round = 0; round < 3; round++)
+    {
+        /** user orders land between dataset orders, and more arrive after the indexes were built */
+        for (uint64_t i = 0; i < 150; i++)
+        {
+            uint64_t at = (i * 37 + round * 11) % dataset.size();
+            OrderBookEntry order{dataset[at].price, 2.0 + i % 5, OrderArchive::formatTimestamp(start + at * 1000 + 100 + round * 100 + i % 3),
+                dataset[at].product, i % 2 == 0 ? OrderBookType::bid : OrderBookType::ask, owners[i % 2]};
+            placeUserOrder(book, order, TimeInForce::gtc);
+            orders.push_back(order);
+        }
+
+        std::stable_sort(orders.begin(), orders.end(), OrderBookEntry::compareByTimestamp);
+
+        for (size_t q = 0; q < queries.size(); q++)
+        {
+            OrderQueryResult found = book.queryOrders(queries[q]);
+            OrderQueryResult expected = scanOrderQuery(orders, queries[q]);
+            bool same = found.count == expected.count && found.rows.size() == expected.rows.size() &&
+                closeTo(found.totalAmount, expected.totalAmount) && closeTo(found.totalNotional, expected.totalNotional) &&
+                found.minPrice == expected.minPrice && found.maxPrice == expected.maxPrice;
+
+            for (size_t i = 0; same && i < found.rows.size(); i++)
+                same = found.rows[i].timestamp == expected.rows[i].timestamp && found.rows[i].username == expected.rows[i].username;
+
+            check(same, "order query " + std::to_string(q) + " in round " + std::to_string(round) + " counted " +
+                std::to_string(found.count) + " orders where a scan finds " + std::to_string(expected.count));
+        }
+    }
+}
+
+int main()
+{
+    checkTimerBoundaries();
+    checkFillOrKillPriority();
+    checkOrderQueue();
+    checkArchiveRoundTrip();
+    checkOrderQueries();
+
+    if (failures == 0)
+        std::cout << "All checks passed" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}